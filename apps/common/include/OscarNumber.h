@@ -21,18 +21,65 @@
 #include "polymake/client.h"
 #include "polymake/Polynomial.h"
 #include "polymake/Integer.h"
+#include "polymake/Rational.h"
+#include "polymake/QuadraticExtension.h"
 #include "polymake/Array.h"
 
+#include <functional>
+#include <string>
+#include <vector>
+
+// opaque julia object, see julia.h
+typedef struct _jl_value_t jl_value_t;
+
 namespace polymake { namespace common {
 
 namespace juliainterface {
 
-class oscar_number_wrap;
+struct oscar_number_dispatch;
+class julia_operand;
+
+// handle of the slot rooting a julia element, see rooting_arena
+struct root_slot {
+   uint32_t index;
+   uint32_t generation;
+};
 
 }
 
 class OscarNumber;
 
+template <typename FieldTag>
+class OscarNumberT;
+
+class OscarNumberDenseStorage;
+
+// hit statistics of the per-field cache of embedded rational constants
+struct OscarNumberCacheStats {
+   Int small_hits = 0;
+   Int lru_hits = 0;
+   Int misses = 0;
+   Int evictions = 0;
+};
+
+// success rate of the interval filter for sign, is_zero and cmp
+struct OscarNumberFilterStats {
+   // answered from the enclosures / passed on to the exact julia predicate
+   Int decided = 0;
+   Int undecided = 0;
+   // enclosures computed via julia
+   Int enclosures = 0;
+};
+
+// instrumentation of one field callback, of a public operation ("OscarNumber::..."),
+// or of an event in the C++ layer
+struct OscarNumberCallStats {
+   std::string name;
+   Int calls = 0;
+   // total time spent in the callback or operation in nanoseconds, 0 for events
+   Int ns = 0;
+};
+
 } }
 
 namespace pm {
@@ -62,13 +109,101 @@ struct spec_object_traits< polymake::common::OscarNumber>
 
 namespace polymake { namespace common {
 
-   // this is currently only for fields that embed the rational numbers
-//template <long index>
+// this is currently only for fields that embed the rational numbers,
+// see OscarNumberT for elements of a field known at compile time
 class OscarNumber {
    private:
-      std::unique_ptr<juliainterface::oscar_number_wrap, void(*)(juliainterface::oscar_number_wrap*)> impl;
-
-      explicit OscarNumber(juliainterface::oscar_number_wrap* x);
+      // tagged inline representation, no heap object per value:
+      //   dispatch == nullptr: the value is the rational number `rational` (possibly +-inf)
+      //   otherwise: the value is the julia field element `elem.julia_elem` of the field
+      //              described by `dispatch`, rooted in `elem.slot` of the field's arena,
+      //              and infinite if `elem.infinity` != 0;
+      //              copies share the slot, the element is copied on write
+      //   for a real quadratic field registered as native, the value is `*elem.native`
+      //              computed in C++, `elem.julia_elem` is then only a julia copy created
+      //              on demand (or nullptr), rooted in `elem.slot`
+      const juliainterface::oscar_number_dispatch* dispatch;
+      union {
+         Rational rational;
+         struct {
+            jl_value_t* julia_elem;
+            juliainterface::root_slot slot;
+            Int infinity;
+            QuadraticExtension<Rational>* native;
+         } elem;
+      };
+
+      // takes ownership of the (not yet rooted) julia element v,
+      // fresh must only be set if v is not referenced from anywhere else
+      OscarNumber(jl_value_t* v, const juliainterface::oscar_number_dispatch& d, bool fresh = true);
+
+      // nobody else can see the julia element, it may be modified in place
+      bool julia_elem_unique() const;
+
+      // element of a native real quadratic field
+      OscarNumber(QuadraticExtension<Rational>&& v, const juliainterface::oscar_number_dispatch& d);
+      // the native value about to be modified, a julia copy of the old value is dropped
+      QuadraticExtension<Rational>& native_for_update();
+      // julia element for a native value, created once per value
+      jl_value_t* materialize() const;
+
+      // turn a rational value into an element of the field d
+      void upgrade_to(const juliainterface::oscar_number_dispatch& d);
+      // turn a finite field element which is rational, like sqrt(2)*sqrt(2) or x-x, back
+      // into an inline rational; only checked for native fields and fields with is_rational
+      void demote_if_rational();
+      // upgrade this or check that b lives in the same field
+      void prepare_binary(const OscarNumber& b);
+      // julia element for this value in the field d, taken from the constant cache for rationals
+      // and kept rooted as long as the returned operand lives; it must not be modified or stored
+      juliainterface::julia_operand julia_value_in(const juliainterface::oscar_number_dispatch& d) const;
+      // replace the current julia element by the (not yet rooted) result of a julia operation
+      void replace_julia_elem(jl_value_t* res);
+      // this = a - this and this = a / this, reusing the storage of this for the rvalue operators
+      OscarNumber& reverse_sub(const OscarNumber& a);
+      OscarNumber& reverse_div(const OscarNumber& a);
+      // the field shared by all non-rational operands, nullptr if all are rational
+      static const juliainterface::oscar_number_dispatch* common_field(std::initializer_list<const OscarNumber*> ops);
+      // same for a range of n elements, starting with the field d (may be nullptr);
+      // Entries is a pointer to contiguous elements or a table of their addresses
+      template <typename Entries>
+      static const juliainterface::oscar_number_dispatch* common_field(const juliainterface::oscar_number_dispatch* d, Entries x, Int n);
+      template <typename Entries>
+      static OscarNumber dot_of(Entries a, Entries b, Int n);
+      // release the current contents, the object must be re-initialized afterwards
+      void release();
+      // move the contents of b into this released object
+      void steal(OscarNumber& b) noexcept;
+
+      // operations on finite elements of one field, without any checks or upgrades
+      void field_add(const OscarNumber& b);
+      void field_sub(const OscarNumber& b);
+      void field_mul(const OscarNumber& b);
+      void field_div(const OscarNumber& b);
+      void field_add_mul(const OscarNumber& a, const OscarNumber& b);
+      void field_negate();
+      Int field_cmp(const OscarNumber& b) const;
+      Int field_sign() const;
+      bool field_is_zero() const;
+      // the registered field with the given index
+      static const juliainterface::oscar_number_dispatch& field_dispatch(long index);
+      // the finite rational x as an element of the field d
+      static OscarNumber embed(const Rational& x, const juliainterface::oscar_number_dispatch& d);
+
+      template <typename FieldTag>
+      friend class OscarNumberT;
+
+      // for containers keeping the field elements of their entries in one julia Vector{Any}:
+      // a new container for n entries of the field index, rooted in slot, with the entries
+      // of the container from if given; released with release_container
+      static jl_value_t* new_container(long index, Int n, juliainterface::root_slot& slot,
+                                       jl_value_t* from = nullptr);
+      static void release_container(long index, juliainterface::root_slot slot);
+      // store the element of the finite field element x at position i of a container, marking
+      // it as exposed, or clear the position if x is null
+      static void container_store(jl_value_t* c, Int i, const OscarNumber* x);
+
+      friend class OscarNumberDenseStorage;
 
    public:
 
@@ -77,18 +212,19 @@ class OscarNumber {
       // 0 in Q
       OscarNumber();
 
-      ~OscarNumber() = default;
+      ~OscarNumber();
 
       // x in Q
       explicit OscarNumber(const Rational& x);
 
       OscarNumber(const OscarNumber& x);
-      OscarNumber(OscarNumber&& x);
+      OscarNumber(OscarNumber&& x) noexcept;
 
       OscarNumber(void* x, Int index);
 
       OscarNumber& operator= (const Rational& b);
       OscarNumber& operator= (const OscarNumber& b);
+      OscarNumber& operator= (OscarNumber&& b);
 
       //
       OscarNumber& operator+= (const Rational& b);
@@ -106,8 +242,44 @@ class OscarNumber {
          return nf.negate();
       }
 
+      friend OscarNumber negate(OscarNumber&& nf) {
+         return std::move(nf.negate());
+      }
+
       friend OscarNumber pow(const OscarNumber& a, Int k);
 
+      friend OscarNumber pow(OscarNumber&& a, Int k) {
+         if (k == 1)
+            return std::move(a);
+         return pow(static_cast<const OscarNumber&>(a), k);
+      }
+
+      // fused operations, each costs a single julia call if the field provides it
+      // this += a*b
+      OscarNumber& add_mul(const OscarNumber& a, const OscarNumber& b);
+      // this -= a*b
+      OscarNumber& sub_mul(const OscarNumber& a, const OscarNumber& b);
+      // a*b + c
+      friend OscarNumber fma(const OscarNumber& a, const OscarNumber& b, const OscarNumber& c);
+      // a*b - c*d
+      friend OscarNumber cross_diff(const OscarNumber& a, const OscarNumber& b, const OscarNumber& c, const OscarNumber& d);
+      // (a*b - c*d) / p for an exact division as in fraction-free elimination, a single
+      // julia call if the field provides it; otherwise cross_diff times inv_p == 1/p,
+      // so that callers dividing many entries by the same p only invert it once
+      friend OscarNumber cross_diff_div(const OscarNumber& a, const OscarNumber& b, const OscarNumber& c, const OscarNumber& d,
+                                        const OscarNumber& p, const OscarNumber& inv_p);
+
+      // batched kernels on contiguous ranges of n entries, pairs of field elements are
+      // handled with a single julia call per range, entries involving rationals separately
+      // sum of a[i]*b[i]
+      static OscarNumber dot(const OscarNumber* a, const OscarNumber* b, Int n);
+      // the same for entries given by their addresses, e.g. of vectors which are not contiguous
+      static OscarNumber dot(const OscarNumber* const* a, const OscarNumber* const* b, Int n);
+      // sign of the sum of a[i]*b[i]
+      static Int sign_of_dot(const OscarNumber* a, const OscarNumber* b, Int n);
+      // y[i] += c*x[i]
+      static void add_scaled(OscarNumber* y, const OscarNumber& c, const OscarNumber* x, Int n);
+
       Int cmp(const OscarNumber& b) const;
       Int cmp(const Rational& b) const;
 
@@ -118,6 +290,12 @@ class OscarNumber {
 
       friend OscarNumber abs(const OscarNumber& on);
 
+      friend OscarNumber abs(OscarNumber&& on) {
+         if (on.sign() < 0)
+            on.negate();
+         return std::move(on);
+      }
+
       size_t hash() const;
 
       // infinity
@@ -132,6 +310,14 @@ class OscarNumber {
 
       void* unsafe_get() const;
 
+      // bulk exchange with julia, rooting all elements with a single lock:
+      // from_julia makes out[i] the elements elems[i] of the field index, they are shared
+      // with julia instead of copied and must not be modified in place by julia afterwards;
+      // to_julia returns a new julia Vector{Any} with the elements *x[i], rationals are
+      // converted to elements of the field index
+      static void from_julia(void* const* elems, Int n, long index, OscarNumber* out);
+      static void* to_julia(const OscarNumber* const* x, Int n, long index);
+
       // TODO check
       inline friend void relocate(OscarNumber* from, OscarNumber* to) {
          pm::relocate(from,to);
@@ -169,6 +355,11 @@ class OscarNumber {
       inline friend OscarNumber operator- (const OscarNumber& a) {
          return std::move(OscarNumber(a).negate());
       }
+      inline friend OscarNumber operator- (OscarNumber&& a) {
+         return std::move(a.negate());
+      }
+
+      // the binary operators below reuse a temporary operand for the result
 
       friend bool abs_equal(const OscarNumber& on1, const OscarNumber& on2);
 
@@ -183,18 +374,40 @@ class OscarNumber {
       {
          return std::move(OscarNumber(a) += b);
       }
+      inline friend OscarNumber operator+ (OscarNumber&& a, const OscarNumber& b)
+      {
+         return std::move(a += b);
+      }
+      inline friend OscarNumber operator+ (const OscarNumber& a, OscarNumber&& b)
+      {
+         return std::move(b += a);
+      }
+      inline friend OscarNumber operator+ (OscarNumber&& a, OscarNumber&& b)
+      {
+         return std::move(a += b);
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator+ (const OscarNumber& a, const T& b)
       {
          return std::move(OscarNumber(a) += Rational(b));
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator+ (OscarNumber&& a, const T& b)
+      {
+         return std::move(a += Rational(b));
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator+ (const T& a, const OscarNumber& b)
       {
          return b+a;
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator+ (const T& a, OscarNumber&& b)
+      {
+         return std::move(b += Rational(a));
+      }
 
       // Arithmetic -
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
@@ -207,18 +420,40 @@ class OscarNumber {
       {
          return std::move(OscarNumber(a) -= b);
       }
+      inline friend OscarNumber operator- (OscarNumber&& a, const OscarNumber& b)
+      {
+         return std::move(a -= b);
+      }
+      inline friend OscarNumber operator- (const OscarNumber& a, OscarNumber&& b)
+      {
+         return std::move(b.reverse_sub(a));
+      }
+      inline friend OscarNumber operator- (OscarNumber&& a, OscarNumber&& b)
+      {
+         return std::move(a -= b);
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator- (const OscarNumber& a, const T& b)
       {
          return std::move(OscarNumber(a) -= Rational(b));
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator- (OscarNumber&& a, const T& b)
+      {
+         return std::move(a -= Rational(b));
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator- (const T& a, const OscarNumber& b)
       {
          return (-b)+a;
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator- (const T& a, OscarNumber&& b)
+      {
+         return std::move(b.negate() += Rational(a));
+      }
 
       // Arithmetic *
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
@@ -231,18 +466,40 @@ class OscarNumber {
       {
          return std::move(OscarNumber(a) *= b);
       }
+      inline friend OscarNumber operator* (OscarNumber&& a, const OscarNumber& b)
+      {
+         return std::move(a *= b);
+      }
+      inline friend OscarNumber operator* (const OscarNumber& a, OscarNumber&& b)
+      {
+         return std::move(b *= a);
+      }
+      inline friend OscarNumber operator* (OscarNumber&& a, OscarNumber&& b)
+      {
+         return std::move(a *= b);
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator* (const OscarNumber& a, const T& b)
       {
          return std::move(OscarNumber(a) *= Rational(b));
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator* (OscarNumber&& a, const T& b)
+      {
+         return std::move(a *= Rational(b));
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator* (const T& a, const OscarNumber& b)
       {
          return b*a;
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator* (const T& a, OscarNumber&& b)
+      {
+         return std::move(b *= Rational(a));
+      }
 
       // Arithmetic *
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
@@ -255,18 +512,40 @@ class OscarNumber {
       {
          return std::move(OscarNumber(a) /= b);
       }
+      inline friend OscarNumber operator/ (OscarNumber&& a, const OscarNumber& b)
+      {
+         return std::move(a /= b);
+      }
+      inline friend OscarNumber operator/ (const OscarNumber& a, OscarNumber&& b)
+      {
+         return std::move(b.reverse_div(a));
+      }
+      inline friend OscarNumber operator/ (OscarNumber&& a, OscarNumber&& b)
+      {
+         return std::move(a /= b);
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator/ (const OscarNumber& a, const T& b)
       {
          return std::move(OscarNumber(a) /= Rational(b));
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator/ (OscarNumber&& a, const T& b)
+      {
+         return std::move(a /= Rational(b));
+      }
 
       template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
       inline friend OscarNumber operator/ (const T& a, const OscarNumber& b)
       {
          return std::move(OscarNumber(a) /= b);
       }
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      inline friend OscarNumber operator/ (const T& a, OscarNumber&& b)
+      {
+         return std::move(b.reverse_div(OscarNumber(a)));
+      }
 
 
       // comparison
@@ -367,18 +646,82 @@ class OscarNumber {
 
       std::string to_string() const;
 
+      // compact binary encoding, see oscarnumber_binary.h
       std::string to_serialized() const;
-
+      void append_serialized(std::string& out) const;
+      // decode one element starting at pos and advance pos,
+      // field elements are created in the field with the given index
+      static OscarNumber from_serialized(const char*& pos, const char* end, long index);
+
+      // index of the field of this element, 0 for rationals
+      long field_index() const;
+      // string identifying the field with the given index, empty if not provided
+      static std::string field_descriptor(long index);
+
+      // dispatch_helper points to an oscar_number_dispatch_helper of helper_size bytes,
+      // see oscarnumber_dispatch_helper.h; without a size only the mandatory callbacks are read
       static void register_oscar_number(void* dispatch_helper, long index);
+      static void register_oscar_number(void* dispatch_helper, long index, size_t helper_size);
+
+      // make the calling thread known to julia (needs julia >= 1.9); this happens
+      // automatically when a thread which was not started by julia first uses a field element
+      static void attach_thread();
+
+      // statistics of the constant cache of the field with the given index
+      static OscarNumberCacheStats constant_cache_stats(long index);
+      // statistics of the interval filter of the field with the given index
+      static OscarNumberFilterStats filter_stats(long index);
+
+      // instrumentation of the julia boundary, off by default:
+      // calls and time of each callback of a field, followed by the events
+      // "upgrade" (rationals upgraded to field elements), "demotion" (rational
+      // results converted back to rationals) and "shared_write"
+      // (shared elements replaced instead of updated in place), and calls and
+      // total time of the public operations like "OscarNumber::+=" or
+      // "OscarNumber::cmp"; the difference to the time of their callbacks is
+      // the cost of the C++ layer
+      static void set_instrumentation(bool enable);
+      static bool instrumentation();
+      static std::vector<OscarNumberCallStats> call_stats(long index);
+      static void reset_call_stats(long index);
 
    }; // end OscarNumber
 
+#if defined(__LP64__)
+// a dense entry is the dispatch pointer and an mpq_t (or the julia element, its slot, the
+// infinity flag and the native value); a field element also takes a slot of 48 bytes in the
+// arena of its field, which copies share
+static_assert(sizeof(OscarNumber) == 40, "OscarNumber must stay a pointer plus an mpq_t");
+#endif
+
+// While a scope is alive, the julia temporaries released by OscarNumber computations
+// of the current thread are handed back to their fields in batches instead of one by
+// one; the rest are returned when the scope ends.  Scopes may be nested and only
+// affect the thread which created them.
+class OscarNumberScope {
+   public:
+      OscarNumberScope();
+      ~OscarNumberScope();
+
+      OscarNumberScope(const OscarNumberScope&) = delete;
+      OscarNumberScope& operator= (const OscarNumberScope&) = delete;
+};
+
 inline bool abs_equal(const polymake::common::OscarNumber& on1,const polymake::common::OscarNumber& on2) {
    return abs(on1).cmp(on2) == 0;
 }
 
 void oscarnumber_prepare_cleanup();
 
+// number of threads used by the parallel linear algebra kernels, defaults to the
+// number of hardware threads; 1 disables multi-threading
+Int oscarnumber_threads();
+void set_oscarnumber_threads(Int n);
+
+// runs body(begin, end) on consecutive chunks of [0, n) with at least grain indices each,
+// in parallel on julia-adopted worker threads if possible
+void oscarnumber_parallel_for(Int n, Int grain, const std::function<void(Int, Int)>& body);
+
 } }
 
 
@@ -450,4 +793,6 @@ namespace std {
    };
 }
 
+#include "polymake/common/oscarnumber_linalg.h"
+
 #endif
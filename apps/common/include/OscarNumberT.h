@@ -0,0 +1,253 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_COMMON_OSCARNUMBERT_H
+#define POLYMAKE_COMMON_OSCARNUMBERT_H
+
+#include "polymake/common/OscarNumber.h"
+
+#include <vector>
+
+namespace polymake { namespace common {
+
+// Element of an oscar field which is fixed at compile time by FieldTag, for code
+// working in a single field.  FieldTag provides the index of a registered field:
+//
+//    struct my_field { static long index() { return 2; } };
+//
+// Values are always finite elements of this field: there are no rational values,
+// no upgrades and no field checks in the operations, and the field is looked up
+// only once per FieldTag.
+// Conversions from and to OscarNumber check the field once and share the julia
+// element; the batched kernels of OscarNumber are reached through get(), without
+// assuming anything about the layout of OscarNumberT.
+template <typename FieldTag>
+class OscarNumberT {
+   public:
+      // 0 in the field
+      OscarNumberT() :
+         value(OscarNumber::embed(Rational(0), field())) {}
+
+      explicit OscarNumberT(const Rational& x) :
+         value(OscarNumber::embed(x, field())) {}
+
+      template <typename T, typename=std::enable_if_t<pm::can_initialize<pure_type_t<T>, Rational>::value>>
+      explicit OscarNumberT(const T& x) :
+         OscarNumberT(Rational(x)) {}
+
+      // x must be rational or a finite element of this field
+      explicit OscarNumberT(const OscarNumber& x) :
+         value(from_dynamic(OscarNumber(x))) {}
+      explicit OscarNumberT(OscarNumber&& x) :
+         value(from_dynamic(std::move(x))) {}
+
+      // the value as an OscarNumber, without a copy
+      const OscarNumber& get() const { return value; }
+      operator const OscarNumber& () const { return value; }
+      OscarNumber release() && { return std::move(value); }
+
+      static const juliainterface::oscar_number_dispatch& field() {
+         static const juliainterface::oscar_number_dispatch& d = OscarNumber::field_dispatch(FieldTag::index());
+         return d;
+      }
+
+      OscarNumberT& operator+= (const OscarNumberT& b) {
+         value.field_add(b.value);
+         return *this;
+      }
+      OscarNumberT& operator-= (const OscarNumberT& b) {
+         value.field_sub(b.value);
+         return *this;
+      }
+      OscarNumberT& operator*= (const OscarNumberT& b) {
+         value.field_mul(b.value);
+         return *this;
+      }
+      OscarNumberT& operator/= (const OscarNumberT& b) {
+         if (__builtin_expect(b.value.field_is_zero(), 0))
+            throw pm::GMP::ZeroDivide();
+         value.field_div(b.value);
+         return *this;
+      }
+
+      // mixed operations with finite rationals
+      OscarNumberT& operator+= (const Rational& b) {
+         value += finite(b);
+         return *this;
+      }
+      OscarNumberT& operator-= (const Rational& b) {
+         value -= finite(b);
+         return *this;
+      }
+      OscarNumberT& operator*= (const Rational& b) {
+         value *= finite(b);
+         return *this;
+      }
+      OscarNumberT& operator/= (const Rational& b) {
+         value /= finite(b);
+         return *this;
+      }
+
+      OscarNumberT& negate() {
+         value.field_negate();
+         return *this;
+      }
+
+      // this += a*b
+      OscarNumberT& add_mul(const OscarNumberT& a, const OscarNumberT& b) {
+         value.field_add_mul(a.value, b.value);
+         return *this;
+      }
+
+      // sum of a[i]*b[i] with a single julia call, see OscarNumber::dot
+      static OscarNumberT dot(const OscarNumberT* a, const OscarNumberT* b, Int n) {
+         if (!n)
+            return OscarNumberT();
+         std::vector<const OscarNumber*> av(n), bv(n);
+         for (Int i = 0; i < n; ++i) {
+            av[i] = &a[i].value;
+            bv[i] = &b[i].value;
+         }
+         return OscarNumberT(OscarNumber::dot(av.data(), bv.data(), n));
+      }
+
+      Int cmp(const OscarNumberT& b) const { return value.field_cmp(b.value); }
+      Int cmp(const Rational& b) const { return value.cmp(b); }
+      bool is_zero() const { return value.field_is_zero(); }
+      bool is_one() const { return value.is_one(); }
+      Int sign() const { return value.field_sign(); }
+
+      size_t hash() const { return value.hash(); }
+      std::string to_string() const { return value.to_string(); }
+      void* unsafe_get() const { return value.unsafe_get(); }
+
+      friend OscarNumberT operator- (OscarNumberT a) {
+         return std::move(a.negate());
+      }
+
+      friend OscarNumberT operator+ (OscarNumberT a, const OscarNumberT& b) {
+         return std::move(a += b);
+      }
+      friend OscarNumberT operator- (OscarNumberT a, const OscarNumberT& b) {
+         return std::move(a -= b);
+      }
+      friend OscarNumberT operator* (OscarNumberT a, const OscarNumberT& b) {
+         return std::move(a *= b);
+      }
+      friend OscarNumberT operator/ (OscarNumberT a, const OscarNumberT& b) {
+         return std::move(a /= b);
+      }
+
+      friend bool operator== (const OscarNumberT& a, const OscarNumberT& b) { return a.cmp(b) == 0; }
+      friend bool operator!= (const OscarNumberT& a, const OscarNumberT& b) { return a.cmp(b) != 0; }
+      friend bool operator<  (const OscarNumberT& a, const OscarNumberT& b) { return a.cmp(b) < 0; }
+      friend bool operator<= (const OscarNumberT& a, const OscarNumberT& b) { return a.cmp(b) <= 0; }
+      friend bool operator>  (const OscarNumberT& a, const OscarNumberT& b) { return a.cmp(b) > 0; }
+      friend bool operator>= (const OscarNumberT& a, const OscarNumberT& b) { return a.cmp(b) >= 0; }
+
+      friend Int sign(const OscarNumberT& a) { return a.sign(); }
+
+      friend OscarNumberT abs(OscarNumberT a) {
+         if (a.sign() < 0)
+            a.negate();
+         return a;
+      }
+
+      friend OscarNumberT pow(const OscarNumberT& a, Int k) {
+         return OscarNumberT(pow(a.value, k));
+      }
+
+   private:
+      static OscarNumber from_dynamic(OscarNumber&& x) {
+         if (!x.dispatch)
+            return OscarNumber::embed(x.rational, field());
+         if (x.dispatch != &field())
+            throw std::runtime_error("OscarNumberT: element of a different field");
+         if (x.elem.infinity)
+            throw std::runtime_error("OscarNumber: infinite value in a field-typed element");
+         return std::move(x);
+      }
+
+      static const Rational& finite(const Rational& b) {
+         if (__builtin_expect(!isfinite(b), 0))
+            throw std::runtime_error("OscarNumber: infinite value in a field-typed element");
+         return b;
+      }
+
+      OscarNumber value;
+};
+
+} }
+
+namespace pm {
+
+template <typename FieldTag>
+struct spec_object_traits< polymake::common::OscarNumberT<FieldTag> >
+   : spec_object_traits<is_scalar> {
+   typedef polymake::common::OscarNumberT<FieldTag> persistent_type;
+   typedef void generic_type;
+   typedef is_scalar generic_tag;
+
+   static
+   bool is_zero(const persistent_type& p) { return p.is_zero(); }
+
+   static
+   bool is_one(const persistent_type& p) { return p.is_one(); }
+
+   static
+   const persistent_type& zero()
+   {
+      static const persistent_type x(0);
+      return x;
+   }
+
+   static
+   const persistent_type& one()
+   {
+      static const persistent_type x(1);
+      return x;
+   }
+};
+
+template <typename FieldTag>
+struct algebraic_traits< polymake::common::OscarNumberT<FieldTag> > {
+   typedef polymake::common::OscarNumberT<FieldTag> field_type;
+};
+
+template <typename FieldTag>
+struct hash_func<polymake::common::OscarNumberT<FieldTag>, is_scalar> {
+public:
+   size_t operator() (const polymake::common::OscarNumberT<FieldTag>& on) const {
+      return on.hash();
+   }
+};
+
+template <typename Output, typename FieldTag>
+Output& operator<< (GenericOutput<Output>& out, const polymake::common::OscarNumberT<FieldTag>& me) {
+   out.top() << me.to_string();
+   return out.top();
+}
+
+}
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
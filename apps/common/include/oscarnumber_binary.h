@@ -0,0 +1,152 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_COMMON_OSCARNUMBER_BINARY_H
+#define POLYMAKE_COMMON_OSCARNUMBER_BINARY_H
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/Matrix.h"
+#include "polymake/Vector.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace polymake { namespace common {
+
+// Binary format for dense matrices over an oscar field, version 1.
+// All integers are stored in native byte order, the limb size in the header
+// guards against reading a file on an incompatible machine.
+//
+//   header:  "OSCN", uint32 version, uint32 limb size in bytes, uint32 0,
+//            uint64 length of the field descriptor, the descriptor
+//            (empty if all entries are rational), uint64 number of columns
+//   rows:    the encoded entries of each row
+//   footer:  uint64 offset of each row, uint64 number of rows,
+//            uint64 offset of the footer, "OSCN"
+//
+// Each entry starts with a tag byte: 0 rational, 1 +inf, 2 -inf, 3 field element.
+// A rational is written as numerator and denominator, a field element as uint64 n
+// followed by its n rational coefficients; an integer is written as int64 signed
+// limb count followed by the raw limbs.
+
+// streaming writer, rows can be written as soon as they are computed
+class OscarNumberBinaryWriter {
+   public:
+      // field_index 0: all entries must be rational
+      OscarNumberBinaryWriter(std::ostream& os_, long field_index_, Int cols_);
+
+      OscarNumberBinaryWriter(const OscarNumberBinaryWriter&) = delete;
+      OscarNumberBinaryWriter& operator= (const OscarNumberBinaryWriter&) = delete;
+
+      template <typename TVector>
+      void write_row(const GenericVector<TVector, OscarNumber>& v)
+      {
+         if (v.dim() != n_cols)
+            throw std::runtime_error("OscarNumberBinaryWriter - dimension mismatch");
+         buffer.clear();
+         for (auto e = entire(v.top()); !e.at_end(); ++e) {
+            // the reader creates all field elements in the declared field,
+            // only the rationals and the infinities are stored without one
+            const long e_field = e->field_index();
+            if (e_field != 0 && e_field != field_index && !e->is_inf())
+               throw std::runtime_error("OscarNumberBinaryWriter - entry from a different field");
+            e->append_serialized(buffer);
+         }
+         write_buffer();
+      }
+
+      // write the row index, the file is incomplete without it
+      void finish();
+
+   private:
+      void write_buffer();
+
+      std::ostream& os;
+      long field_index;
+      Int n_cols;
+      uint64_t offset = 0;
+      std::vector<uint64_t> row_offsets;
+      std::string buffer;
+      bool finished = false;
+};
+
+// memory mapped reader, rows are only decoded when they are requested
+class OscarNumberBinaryReader {
+   public:
+      // field elements are created in the field with the given index,
+      // its descriptor must match the one stored in the file
+      OscarNumberBinaryReader(const std::string& filename, long field_index);
+      ~OscarNumberBinaryReader();
+
+      OscarNumberBinaryReader(const OscarNumberBinaryReader&) = delete;
+      OscarNumberBinaryReader& operator= (const OscarNumberBinaryReader&) = delete;
+
+      Int rows() const { return n_rows; }
+      Int cols() const { return n_cols; }
+
+      Vector<OscarNumber> row(Int i) const;
+      Matrix<OscarNumber> matrix() const;
+
+   private:
+      const char* row_begin(Int i) const;
+
+      const char* data = nullptr;
+      size_t size = 0;
+      long index;
+      Int n_rows = 0;
+      Int n_cols = 0;
+      const char* row_index = nullptr;
+      const char* rows_end = nullptr;
+};
+
+template <typename TMatrix>
+void write_binary(std::ostream& os, const GenericMatrix<TMatrix, OscarNumber>& M)
+{
+   long field_index = 0;
+   for (auto e = entire(concat_rows(M.top())); !e.at_end() && !field_index; ++e)
+      field_index = e->field_index();
+   OscarNumberBinaryWriter writer(os, field_index, M.cols());
+   for (auto r = entire(rows(M.top())); !r.at_end(); ++r)
+      writer.write_row(*r);
+   writer.finish();
+}
+
+template <typename TVector>
+void write_binary(std::ostream& os, const GenericVector<TVector, OscarNumber>& v)
+{
+   write_binary(os, vector2row(v));
+}
+
+// the same to a file, which is replaced
+void write_binary(const std::string& filename, const Matrix<OscarNumber>& M);
+
+inline
+Matrix<OscarNumber> read_binary(const std::string& filename, long field_index)
+{
+   return OscarNumberBinaryReader(filename, field_index).matrix();
+}
+
+} }
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
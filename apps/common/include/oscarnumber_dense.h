@@ -0,0 +1,212 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_COMMON_OSCARNUMBER_DENSE_H
+#define POLYMAKE_COMMON_OSCARNUMBER_DENSE_H
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/Matrix.h"
+#include "polymake/Vector.h"
+
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+namespace polymake { namespace common {
+
+// Compact dense storage of n entries over a single oscar field, for large vectors and
+// matrices which are mostly stored and read row by row rather than computed with.
+// The field is stored once per container, the field elements live in one julia
+// Vector{Any} which is rooted with a single slot, a bitmap marks the rational entries
+// and only the nonzero rationals (and infinities) are kept in a separate table;
+// so an entry takes one pointer and one bit, instead of a full OscarNumber with its own slot.
+// Field elements are shared with the OscarNumbers they are read from or written to,
+// the shared elements are marked as exposed and thus copied by the first modification
+// on either side instead of being modified in place.
+// Reading an entry roots it in a fresh slot of the field, a range of entries with a single
+// lock of the rooting arena.
+// For a native quadratic field each access converts the element from or to julia.
+// These are standalone containers: Matrix<OscarNumber> and Vector<OscarNumber> keep their
+// own layout, convert with the constructors and to_matrix or to_vector.
+class OscarNumberDenseStorage {
+   public:
+      explicit OscarNumberDenseStorage(Int n_ = 0);
+      OscarNumberDenseStorage(const OscarNumberDenseStorage& s);
+      OscarNumberDenseStorage(OscarNumberDenseStorage&& s) noexcept;
+      OscarNumberDenseStorage& operator= (OscarNumberDenseStorage s) noexcept;
+      ~OscarNumberDenseStorage();
+
+      void swap(OscarNumberDenseStorage& s) noexcept;
+
+      Int size() const { return n; }
+      // 0 as long as all entries are rational
+      long field_index() const { return index; }
+
+      bool is_rational(Int i) const {
+         return rational_bits[i / 64] >> (i % 64) & 1;
+      }
+
+      OscarNumber get(Int i) const;
+      // the entries [i, i+m) with a single lock of the field's rooting arena
+      void get(Int i, Int m, OscarNumber* out) const;
+
+      // x must be rational or an element of the field of the other entries
+      void set(Int i, const OscarNumber& x);
+
+   private:
+      void set_rational(Int i, Rational&& x);
+      void attach_field(long field);
+      void* entry(Int i) const;
+
+      Int n;
+      long index = 0;
+      // Vector{Any} of the field elements, nullptr until the first one is stored
+      jl_value_t* entries = nullptr;
+      juliainterface::root_slot slot{};
+      std::vector<uint64_t> rational_bits;
+      std::unordered_map<Int, Rational> rationals;
+};
+
+// read-only view of the consecutive entries [start, start+n) of a storage, e.g. a row of
+// a matrix; the entries are returned by value and share their field elements with it
+class OscarNumberDenseSlice {
+   public:
+      class const_iterator {
+         public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = OscarNumber;
+            using difference_type = Int;
+            using pointer = void;
+            using reference = OscarNumber;
+
+            const_iterator(const OscarNumberDenseStorage& s_, Int i_) : s(&s_), i(i_) {}
+
+            OscarNumber operator* () const { return s->get(i); }
+            bool is_rational() const { return s->is_rational(i); }
+            const_iterator& operator++ () { ++i; return *this; }
+            const_iterator operator++ (int) { const_iterator it(*this); ++i; return it; }
+            bool operator== (const const_iterator& it) const { return i == it.i; }
+            bool operator!= (const const_iterator& it) const { return i != it.i; }
+
+         private:
+            const OscarNumberDenseStorage* s;
+            Int i;
+      };
+
+      OscarNumberDenseSlice(const OscarNumberDenseStorage& s_, Int start_, Int n_) :
+         s(s_), start(start_), n(n_) {}
+
+      Int dim() const { return n; }
+      OscarNumber operator[] (Int i) const { return s.get(start + i); }
+      bool is_rational(Int i) const { return s.is_rational(start + i); }
+
+      const_iterator begin() const { return const_iterator(s, start); }
+      const_iterator end() const { return const_iterator(s, start + n); }
+
+      Vector<OscarNumber> to_vector() const
+      {
+         Vector<OscarNumber> v(n);
+         if (n)
+            s.get(start, n, &v[0]);
+         return v;
+      }
+
+   private:
+      const OscarNumberDenseStorage& s;
+      Int start, n;
+};
+
+class OscarNumberDenseVector {
+   public:
+      explicit OscarNumberDenseVector(Int dim_ = 0) : data(dim_) {}
+
+      template <typename TVector>
+      explicit OscarNumberDenseVector(const GenericVector<TVector, OscarNumber>& v) :
+         data(v.dim())
+      {
+         Int i = 0;
+         for (auto e = entire(v.top()); !e.at_end(); ++e, ++i)
+            data.set(i, *e);
+      }
+
+      Int dim() const { return data.size(); }
+      long field_index() const { return data.field_index(); }
+
+      OscarNumber operator[] (Int i) const { return data.get(i); }
+      bool is_rational(Int i) const { return data.is_rational(i); }
+      void set(Int i, const OscarNumber& x) { data.set(i, x); }
+
+      OscarNumberDenseSlice::const_iterator begin() const { return entries().begin(); }
+      OscarNumberDenseSlice::const_iterator end() const { return entries().end(); }
+      OscarNumberDenseSlice entries() const { return OscarNumberDenseSlice(data, 0, dim()); }
+
+      Vector<OscarNumber> to_vector() const { return entries().to_vector(); }
+
+   private:
+      OscarNumberDenseStorage data;
+};
+
+// the entries are stored row by row
+class OscarNumberDenseMatrix {
+   public:
+      OscarNumberDenseMatrix() : n_rows(0), n_cols(0) {}
+      OscarNumberDenseMatrix(Int rows_, Int cols_) : data(rows_ * cols_), n_rows(rows_), n_cols(cols_) {}
+
+      template <typename TMatrix>
+      explicit OscarNumberDenseMatrix(const GenericMatrix<TMatrix, OscarNumber>& M) :
+         OscarNumberDenseMatrix(M.rows(), M.cols())
+      {
+         Int i = 0;
+         for (auto e = entire(concat_rows(M.top())); !e.at_end(); ++e, ++i)
+            data.set(i, *e);
+      }
+
+      Int rows() const { return n_rows; }
+      Int cols() const { return n_cols; }
+      long field_index() const { return data.field_index(); }
+
+      OscarNumber operator() (Int i, Int j) const { return data.get(i * n_cols + j); }
+      bool is_rational(Int i, Int j) const { return data.is_rational(i * n_cols + j); }
+      void set(Int i, Int j, const OscarNumber& x) { data.set(i * n_cols + j, x); }
+
+      // the entries of row i without copying them
+      OscarNumberDenseSlice row_view(Int i) const { return OscarNumberDenseSlice(data, i * n_cols, n_cols); }
+      Vector<OscarNumber> row(Int i) const { return row_view(i).to_vector(); }
+
+      Matrix<OscarNumber> to_matrix() const
+      {
+         Matrix<OscarNumber> M(n_rows, n_cols);
+         if (data.size())
+            data.get(0, data.size(), &M(0, 0));
+         return M;
+      }
+
+   private:
+      OscarNumberDenseStorage data;
+      Int n_rows, n_cols;
+};
+
+} }
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
@@ -0,0 +1,106 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_COMMON_OSCARNUMBER_DISPATCH_HELPER_H
+#define POLYMAKE_COMMON_OSCARNUMBER_DISPATCH_HELPER_H
+
+#include <cstddef>
+
+namespace polymake { namespace common { namespace juliainterface {
+
+// table of callbacks for one field as passed to OscarNumber::register_oscar_number,
+// the layout must match the julia side; new entries are only appended at the end.
+// The caller passes the size of its table, entries beyond it are treated as null,
+// so tables built against an older version of this header keep working.
+struct oscar_number_dispatch_helper {
+      long index = -1;
+      void* init;
+      void* init_from_mpz;
+      void* copy;
+      void* gc_protect;
+      void* gc_free;
+      void* add;
+      void* sub;
+      void* mul;
+      void* div;
+      void* pow;
+      void* negate;
+      void* cmp;
+      void* to_string;
+      void* from_string;
+      void* is_zero;
+      void* is_one;
+      void* is_inf;
+      void* sign;
+      void* abs;
+      void* hash;
+      void* to_rational;
+      void* to_float;
+      // optional fused operations, may be null
+      void* addmul;
+      void* submul;
+      void* cross_diff;
+      // optional in-place variants (add!, sub!, mul!, div!, neg!, addmul!, submul!), may be null;
+      // they may reuse the storage of their first argument and return the result
+      void* add_inplace;
+      void* sub_inplace;
+      void* mul_inplace;
+      void* div_inplace;
+      void* negate_inplace;
+      void* addmul_inplace;
+      void* submul_inplace;
+      // optional batched vector operations on arrays of n elements, may be null
+      void* dot;
+      void* axpy;
+      void* sign_dot;
+      // optional mixed operations with a rational given as numerator and denominator, may be null
+      void* add_rational;
+      void* sub_rational;
+      void* mul_rational;
+      void* div_rational;
+      void* cmp_rational;
+      // optional certified enclosure [lo, hi] of a real element, may be null
+      void* enclose;
+      // optional conversion from and to rational coefficient vectors, may be null
+      void* coeffs;
+      void* from_coeffs;
+      void* descriptor;
+      // optional mpq_srcptr d, not a square, if the field is the real quadratic field Q(sqrt(d))
+      // with coefficients in the basis (1, sqrt(d)); its elements are then computed in C++ and
+      // only the conversion callbacks are used, requires coeffs and from_coeffs
+      void* quadratic_root;
+      // optional cheap test whether an element is rational, may be null; if present, results
+      // of arithmetic which turn out to be rational are converted back to inline rationals
+      void* is_rational;
+      // optional fused (a*b - c*d) / p where the division is known to be exact,
+      // the update of fraction-free elimination, may be null
+      void* cross_diff_div;
+};
+
+// size of the table expected by the two-argument register_oscar_number,
+// i.e. the index and the mandatory callbacks up to to_float
+constexpr size_t oscar_number_dispatch_helper_legacy_size = offsetof(oscar_number_dispatch_helper, addmul);
+
+} } }
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
@@ -0,0 +1,211 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_COMMON_OSCARNUMBER_LINALG_H
+#define POLYMAKE_COMMON_OSCARNUMBER_LINALG_H
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/Matrix.h"
+#include "polymake/Vector.h"
+
+#include <vector>
+
+namespace polymake { namespace common { namespace oscarnumber_linalg {
+
+// elimination kernels for matrices over oscar fields: fraction-free (Bareiss)
+// elimination updating each entry with the fused cross_diff_div of OscarNumber,
+// with at most a single inversion per pivot instead of a division per entry;
+// rows which are reduced independently are distributed over oscarnumber_threads() threads;
+// matrices whose entries are all rational are converted and handed to the Rational
+// implementations, which avoid the dispatch of OscarNumber in every operation
+
+// all entries are rational, no field element occurs
+bool uses_rational(const Matrix<OscarNumber>& M);
+bool uses_rational(const Vector<OscarNumber>& v);
+
+OscarNumber det(Matrix<OscarNumber> M);
+
+Int rank(const Matrix<OscarNumber>& M);
+
+// For matrices with a field element the basis vector of each column without a pivot is
+// normalized to 1 in this column and 0 in the other columns without a pivot.  Matrices of
+// rationals are handed to pm::null_space, whose basis spans the same space but is not
+// normalized this way; compare the row spaces rather than the matrices.
+Matrix<OscarNumber> null_space(const Matrix<OscarNumber>& M);
+
+// throws degenerate_matrix for a singular matrix
+Matrix<OscarNumber> inv(const Matrix<OscarNumber>& M);
+
+// Fraction-free LU decomposition of a square matrix (Nakos, Turner, Williams):
+// P*M = L * D^-1 * U with L lower and U upper triangular, both with the Bareiss pivots
+// p_1, ..., p_n on their diagonals, and D = diag(p_1, p_1*p_2, ..., p_(n-1)*p_n).
+// All entries of L and U are minors of M, p_n is the determinant of P*M.
+struct lu_decomposition {
+   Matrix<OscarNumber> L, U;
+   // row i of P*M is row row_perm[i] of M
+   std::vector<Int> row_perm;
+};
+
+// throws degenerate_matrix for a singular matrix
+lu_decomposition fraction_free_lu(const Matrix<OscarNumber>& M);
+
+// null space of M without its homogenizing first column, padded with a zero column
+Matrix<OscarNumber> lineality_space(const Matrix<OscarNumber>& M);
+
+// batched vector operations, crossing the julia boundary once per vector
+// instead of once per entry
+
+inline
+OscarNumber dot(const Vector<OscarNumber>& a, const Vector<OscarNumber>& b)
+{
+   if (a.dim() != b.dim())
+      throw std::runtime_error("dot - dimension mismatch");
+   return a.dim() ? OscarNumber::dot(&a[0], &b[0], a.dim()) : OscarNumber();
+}
+
+inline
+Int sign_of_dot(const Vector<OscarNumber>& a, const Vector<OscarNumber>& b)
+{
+   if (a.dim() != b.dim())
+      throw std::runtime_error("sign_of_dot - dimension mismatch");
+   return a.dim() ? OscarNumber::sign_of_dot(&a[0], &b[0], a.dim()) : 0;
+}
+
+// addresses of the entries of a vector which stores them, e.g. a row or column of a Matrix
+template <typename TVector,
+          bool stored=std::is_lvalue_reference<decltype(*entire(std::declval<const TVector&>()))>::value>
+class entry_addresses {
+   public:
+      explicit entry_addresses(const TVector& v)
+      {
+         addr.reserve(v.dim());
+         for (auto e = entire(v); !e.at_end(); ++e)
+            addr.push_back(&*e);
+      }
+      const OscarNumber* const* get() const { return addr.data(); }
+
+   private:
+      std::vector<const OscarNumber*> addr;
+};
+
+// the entries of a lazy vector have to be evaluated first
+template <typename TVector>
+class entry_addresses<TVector, false> {
+   public:
+      explicit entry_addresses(const TVector& v) : values(v), stored(values) {}
+      const OscarNumber* const* get() const { return stored.get(); }
+
+   private:
+      const Vector<OscarNumber> values;
+      const entry_addresses<Vector<OscarNumber>> stored;
+};
+
+// the same for arbitrary dense vectors, their entries are not copied
+template <typename TVector1, typename TVector2>
+OscarNumber dot(const TVector1& a, const TVector2& b)
+{
+   if (a.dim() != b.dim())
+      throw std::runtime_error("dot - dimension mismatch");
+   if (!a.dim())
+      return OscarNumber();
+   const entry_addresses<TVector1> ea(a);
+   const entry_addresses<TVector2> eb(b);
+   return OscarNumber::dot(ea.get(), eb.get(), a.dim());
+}
+
+// y += c*x
+inline
+void add_scaled(Vector<OscarNumber>& y, const OscarNumber& c, const Vector<OscarNumber>& x)
+{
+   if (y.dim() != x.dim())
+      throw std::runtime_error("add_scaled - dimension mismatch");
+   if (y.dim())
+      OscarNumber::add_scaled(&y[0], c, &x[0], y.dim());
+}
+
+} } }
+
+namespace pm {
+
+// these are more specialized than the generic field versions from polymake/linalg.h
+// and thus picked for all matrices with OscarNumber entries
+
+template <typename TVector1, typename TVector2,
+          typename=std::enable_if_t<!check_container_feature<TVector1, sparse>::value &&
+                                    !check_container_feature<TVector2, sparse>::value>>
+polymake::common::OscarNumber
+operator* (const GenericVector<TVector1, polymake::common::OscarNumber>& l,
+           const GenericVector<TVector2, polymake::common::OscarNumber>& r)
+{
+   if (POLYMAKE_DEBUG || is_wary<TVector1>() || is_wary<TVector2>()) {
+      if (l.dim() != r.dim())
+         throw std::runtime_error("GenericVector::operator* - dimension mismatch");
+   }
+   return polymake::common::oscarnumber_linalg::dot(l.top(), r.top());
+}
+
+template <typename TMatrix>
+polymake::common::OscarNumber det(const GenericMatrix<TMatrix, polymake::common::OscarNumber>& m)
+{
+   if (POLYMAKE_DEBUG || is_wary<TMatrix>()) {
+      if (m.rows() != m.cols())
+         throw std::runtime_error("det - non-square matrix");
+   }
+   return polymake::common::oscarnumber_linalg::det(Matrix<polymake::common::OscarNumber>(m));
+}
+
+template <typename TMatrix>
+Int rank(const GenericMatrix<TMatrix, polymake::common::OscarNumber>& M)
+{
+   return polymake::common::oscarnumber_linalg::rank(Matrix<polymake::common::OscarNumber>(M));
+}
+
+template <typename TMatrix>
+typename TMatrix::persistent_nonsymmetric_type
+null_space(const GenericMatrix<TMatrix, polymake::common::OscarNumber>& M)
+{
+   return typename TMatrix::persistent_nonsymmetric_type(
+             polymake::common::oscarnumber_linalg::null_space(Matrix<polymake::common::OscarNumber>(M)));
+}
+
+template <typename TMatrix>
+Matrix<polymake::common::OscarNumber> inv(const GenericMatrix<TMatrix, polymake::common::OscarNumber>& m)
+{
+   if (POLYMAKE_DEBUG || is_wary<TMatrix>()) {
+      if (m.rows() != m.cols())
+         throw std::runtime_error("inv - non-square matrix");
+   }
+   return polymake::common::oscarnumber_linalg::inv(Matrix<polymake::common::OscarNumber>(m));
+}
+
+template <typename TMatrix>
+typename TMatrix::persistent_nonsymmetric_type
+lineality_space(const GenericMatrix<TMatrix, polymake::common::OscarNumber>& M)
+{
+   return typename TMatrix::persistent_nonsymmetric_type(
+             polymake::common::oscarnumber_linalg::lineality_space(Matrix<polymake::common::OscarNumber>(M)));
+}
+
+}
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
@@ -0,0 +1,63 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_COMMON_OSCARNUMBER_LP_H
+#define POLYMAKE_COMMON_OSCARNUMBER_LP_H
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/Matrix.h"
+#include "polymake/Vector.h"
+
+namespace polymake { namespace common {
+
+enum class OscarNumberLPStatus { valid, infeasible, unbounded };
+
+struct OscarNumberLPSolution {
+   OscarNumberLPStatus status = OscarNumberLPStatus::infeasible;
+   // only set for a valid LP
+   OscarNumber objective_value;
+   Vector<OscarNumber> solution;
+   // pivots of the floating point simplex and the exact simplex after the warm start
+   Int float_pivots = 0;
+   Int exact_pivots = 0;
+   // the final basis of the floating point simplex was certified without exact pivots
+   bool certified = false;
+};
+
+// Maximizes (or minimizes) Objective * x over the x with x_0 = 1, Inequalities * x >= 0
+// and Equations * x = 0, in the homogeneous coordinates used by polymake.
+// The simplex (two phases, Bland's rule) first runs on a double approximation
+// obtained via operator double, its final basis is then reconstructed and checked in
+// exact arithmetic: if it is feasible and optimal (or proves infeasibility or
+// unboundedness) no exact pivot is done, otherwise the exact simplex continues from
+// this basis, or from scratch if the basis is singular or infeasible.
+// The rows of the exact tableau are updated in parallel, see oscarnumber_threads().
+// The polytope clients can use it as their LP solver for OscarNumber under the label
+// oscarnumber.simplex, which has to be preferred explicitly.
+OscarNumberLPSolution solve_lp(const Matrix<OscarNumber>& Inequalities,
+                               const Matrix<OscarNumber>& Equations,
+                               const Vector<OscarNumber>& Objective, bool maximize);
+
+} }
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
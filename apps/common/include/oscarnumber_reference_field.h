@@ -0,0 +1,56 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_COMMON_OSCARNUMBER_REFERENCE_FIELD_H
+#define POLYMAKE_COMMON_OSCARNUMBER_REFERENCE_FIELD_H
+
+#include "polymake/common/OscarNumber.h"
+
+namespace polymake { namespace common {
+
+// Reference implementation of the field callbacks in C++, for testing and measuring
+// the overhead of the OscarNumber layer without Oscar.
+// The field is Q(sqrt(root)) computed with QuadraticExtension<Rational>, elements are
+// boxed indices into a C++ table of values which is never shrunk, so this is not
+// meant for long running computations.
+// Only an initialized julia runtime is needed (jl_init), no julia packages.
+// Each callback busy-waits call_cost_ns nanoseconds to simulate the cost of a julia call.
+// With native the field is registered as a native quadratic field, only the conversions
+// then go through the callbacks.
+void register_reference_field(long index, const Rational& root, Int call_cost_ns = 0, bool native = false);
+
+// Q(t) with t the real cube root of root, for measuring fields of higher degree;
+// root must be positive and not the cube of a rational.  It is always registered with
+// the callbacks, elements have three rational coefficients in the basis 1, t, t^2.
+void register_cubic_reference_field(long index, const Rational& root, Int call_cost_ns = 0);
+
+// change the simulated cost of all reference fields
+void set_reference_field_call_cost(Int call_cost_ns);
+
+// sqrt(root) (or the cube root) as an element of the reference field with the given index,
+// further elements are obtained from it by arithmetic with rationals
+OscarNumber reference_field_generator(long index);
+
+} }
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
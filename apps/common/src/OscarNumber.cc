@@ -17,740 +17,2435 @@
 
 #include <julia/julia.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 #include "polymake/client.h"
 #include "polymake/Integer.h"
 #include "polymake/Rational.h"
 #include "polymake/Array.h"
 #include "polymake/Polynomial.h"
 #include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_dispatch_helper.h"
 
 namespace polymake { namespace common {
 
 namespace juliainterface {
 
-typedef struct __oscar_number_dispatch_helper {
-      long index = -1;
-      void* init;
-      void* init_from_mpz;
-      void* copy;
-      void* gc_protect;
-      void* gc_free;
-      void* add;
-      void* sub;
-      void* mul;
-      void* div;
-      void* pow;
-      void* negate;
-      void* cmp;
-      void* to_string;
-      void* from_string;
-      void* is_zero;
-      void* is_one;
-      void* is_inf;
-      void* sign;
-      void* abs;
-      void* hash;
-      void* to_rational;
-      void* to_float;
-} oscar_number_dispatch_helper;
-
-typedef struct __oscar_number_dispatch {
-      long index = -1;
-      std::function<jl_value_t* (long, jl_value_t**, long)> init;
-      std::function<jl_value_t* (long, jl_value_t**, const mpz_srcptr, const mpz_srcptr)> init_from_mpz;
-      std::function<jl_value_t* (jl_value_t*)> copy;
-      std::function<void (jl_value_t*)> gc_protect;
-      std::function<void (jl_value_t*)> gc_free;
-      std::function<jl_value_t* (jl_value_t*, jl_value_t*)> add;
-      std::function<jl_value_t* (jl_value_t*, jl_value_t*)> sub;
-      std::function<jl_value_t* (jl_value_t*, jl_value_t*)> mul;
-      std::function<jl_value_t* (jl_value_t*, jl_value_t*)> div;
-      std::function<jl_value_t* (jl_value_t*, long)> pow;
-      std::function<jl_value_t* (jl_value_t*)> negate;
-      std::function<long (jl_value_t*, jl_value_t*)> cmp;
-      std::function<char* (jl_value_t*)> to_string;
-      std::function<jl_value_t* (char*)> from_string;
-      std::function<bool (jl_value_t*)> is_zero;
-      std::function<bool (jl_value_t*)> is_one;
-      std::function<bool (jl_value_t*)> is_inf;
-      std::function<long (jl_value_t*)> sign;
-      std::function<jl_value_t* (jl_value_t*)> abs;
-      std::function<size_t (jl_value_t*)> hash;
-      std::function<mpq_ptr (jl_value_t*)> to_rational;
-      std::function<double (jl_value_t*)> to_float;
-} oscar_number_dispatch;
-
-class oscar_number_wrap {
+// certified interval enclosure of the value of an element
+struct interval {
+   double lo, hi;
+};
+
+// Threads which were not started by julia (e.g. std::threads of the caller) are
+// adopted on their first contact with the julia runtime: every callback, every lock
+// and every gc frame of the runtime is preceded by this check.
+inline void ensure_julia_thread() {
+   if (__builtin_expect(jl_get_pgcstack() == nullptr, 0))
+      OscarNumber::attach_thread();
+}
+
+// Locks m without stalling the julia garbage collector: while a thread waits for
+// the mutex it is marked gc-safe, so that a collection triggered by the thread
+// holding the mutex can proceed.
+class gc_safe_lock {
    public:
-   virtual ~oscar_number_wrap() { }
-
-   virtual oscar_number_wrap* copy() const = 0;
-   virtual void destruct() = 0;
-   virtual oscar_number_wrap* upgrade_other(oscar_number_wrap* other) const = 0;
-   virtual oscar_number_wrap* upgrade_to(const oscar_number_dispatch& d) = 0;
-   virtual jl_value_t* for_julia() const = 0;
-   virtual Rational as_rational() const = 0;
-   virtual double as_float() const = 0;
-   virtual const Rational& get_rational() const = 0;
-   virtual bool uses_rational() const = 0;
-   virtual long index() const = 0;
-
-   virtual oscar_number_wrap* negate() = 0;
-   virtual oscar_number_wrap* add(const oscar_number_wrap* other) = 0;
-   virtual oscar_number_wrap* sub(const oscar_number_wrap* other) = 0;
-   virtual oscar_number_wrap* mul(const oscar_number_wrap* other) = 0;
-   virtual oscar_number_wrap* div(const oscar_number_wrap* other) = 0;
-   virtual oscar_number_wrap* pow(Int p) const = 0;
-   virtual Int cmp(const oscar_number_wrap* other) const = 0;
-   virtual bool is_zero() const = 0;
-   virtual bool is_one() const = 0;
-   virtual Int is_inf() const = 0;
-   virtual Int sign() const = 0;
-   virtual oscar_number_wrap* abs_value() const = 0;
-   virtual std::string to_string() const = 0;
-   virtual size_t hash() const = 0;
-
-   static oscar_number_wrap* create(const Rational&);
-   static oscar_number_wrap* create(void* v, long index);
-   static void destroy(oscar_number_wrap*);
-   //static oscar_number_wrap* from_string(const std::string& s);
+      explicit gc_safe_lock(std::mutex& m_) : m(m_) {
+         ensure_julia_thread();
+         if (!m.try_lock()) {
+            jl_ptls_t ptls = jl_current_task->ptls;
+            int8_t state = jl_gc_safe_enter(ptls);
+            m.lock();
+            jl_gc_safe_leave(ptls, state);
+         }
+      }
+      ~gc_safe_lock() {
+         m.unlock();
+      }
+
+      gc_safe_lock(const gc_safe_lock&) = delete;
+      gc_safe_lock& operator= (const gc_safe_lock&) = delete;
+
+   private:
+      std::mutex& m;
 };
 
-static std::unordered_map<Int, oscar_number_dispatch> oscar_number_map;
+// Instrumentation of the julia boundary: every callback of a field counts its calls
+// and the time spent in it, the upgrades and demotions of rationals and the writes to shared
+// elements are counted as well.
+// It is always compiled in but only active after OscarNumber::set_instrumentation(true),
+// when disabled the overhead is a single relaxed atomic load per callback.
+static std::atomic<bool> instrumentation_enabled{false};
+
+inline bool instrumented() {
+   return __builtin_expect(instrumentation_enabled.load(std::memory_order_relaxed), 0);
+}
+
+struct call_counter {
+   std::atomic<Int> calls{0};
+   std::atomic<Int> ns{0};
 
-static bool in_cleanup = false;
+   void reset() {
+      calls = 0;
+      ns = 0;
+   }
+};
 
-class oscar_number_impl : public oscar_number_wrap {
+// adds the time until its destruction to a counter
+class call_timer {
    public:
-      // no default construction, this should only contain proper field elements
-      // zero / one / ... is handled via embedded rationals
-      //oscar_number_impl() { };
-      oscar_number_impl() = delete;
-
-      oscar_number_impl(Int x, long field_index) :
-         dispatch(oscar_number_map[field_index]) {
-         //cerr << "pre-init from int" << endl;
-         jl_value_t* empty = nullptr;
-         JL_GC_PUSH2(&julia_elem, &empty);
-         julia_elem = dispatch.init(dispatch.index, &empty, x);
-         dispatch.gc_protect(julia_elem);
-         JL_GC_POP();
+      explicit call_timer(call_counter& c_) :
+         c(c_), start(std::chrono::steady_clock::now()) { }
+      ~call_timer() {
+         const auto elapsed = std::chrono::steady_clock::now() - start;
+         c.calls.fetch_add(1, std::memory_order_relaxed);
+         c.ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                        std::memory_order_relaxed);
       }
 
-      oscar_number_impl(const Rational& x, const oscar_number_dispatch& d) :
-         dispatch(d) {
-         //cerr << "pre-init from mpz" << endl;
-         jl_value_t* empty = nullptr;
-         JL_GC_PUSH2(&julia_elem, &empty);
-         if (__builtin_expect(isfinite(x),1)) {
-            if (x.is_integral() && numerator(x).fits_into_Int()) {
-               julia_elem = dispatch.init(dispatch.index, &empty, static_cast<Int>(x));
-            } else {
-               julia_elem = dispatch.init_from_mpz(dispatch.index, &empty, numerator(x).get_rep(),denominator(x).get_rep());
-            }
-         } else {
-            julia_elem = dispatch.init(dispatch.index, &empty, 1);
-            infinity = isinf(x);
-         }
-         //cerr << "post-init from mpz" << endl;
-         dispatch.gc_protect(julia_elem);
-         //cerr << "post-protect from mpz" << endl;
-         JL_GC_POP();
+      call_timer(const call_timer&) = delete;
+      call_timer& operator= (const call_timer&) = delete;
 
-      }
+   private:
+      call_counter& c;
+      const std::chrono::steady_clock::time_point start;
+};
 
-      oscar_number_impl(const Rational& x, long field_index) :
-         oscar_number_impl(x, oscar_number_map[field_index]) { }
+// a field callback, called like the plain function pointer it wraps
+template <typename Signature>
+class callback;
 
-      // this is a move construction taking ownership of the jl_value_t
-      oscar_number_impl(jl_value_t* v, const oscar_number_dispatch& d, std::true_type) :
-         dispatch(d), julia_elem(v) {
-         //cerr << "moved in constructor" << endl;
-         JL_GC_PUSH1(&julia_elem);
-         dispatch.gc_protect(julia_elem);
-         //cerr << "post-protect in moveconst" << endl;
-         JL_GC_POP();
+template <typename R, typename... Args>
+class callback<R(Args...)> {
+   public:
+      callback& operator= (R (*f)(Args...)) {
+         fptr = f;
+         return *this;
       }
 
-      // this makes a copy
-      oscar_number_impl(jl_value_t* v, const oscar_number_dispatch& d) :
-         dispatch(d) {
-         //cerr << "copy in constructor" << endl;
-         julia_elem = dispatch.copy(v);
-         //cerr << "copied in constructor" << endl;
-         JL_GC_PUSH1(&julia_elem);
-         dispatch.gc_protect(julia_elem);
-         //cerr << "post-protect in copyconst" << endl;
-         JL_GC_POP();
+      explicit operator bool() const { return fptr != nullptr; }
+
+      R operator() (Args... args) const {
+         ensure_julia_thread();
+         if (!instrumented())
+            return fptr(args...);
+         call_timer timer(counter);
+         return fptr(args...);
       }
 
-      oscar_number_impl(jl_value_t* v, long field_index, std::true_type) :
-         oscar_number_impl(v, oscar_number_map[field_index], std::true_type()) { }
+      mutable call_counter counter;
 
-      oscar_number_impl(jl_value_t* v, long field_index) :
-         oscar_number_impl(v, oscar_number_map[field_index]) { }
+   private:
+      R (*fptr)(Args...) = nullptr;
+};
 
-      oscar_number_impl(const oscar_number_impl* x, long field_index) :
-         oscar_number_impl(x->julia_elem, field_index) {
-         infinity = x->infinity;
-         assert(field_index == x->dispatch.index);
-      }
+// Julia elements referenced from C++ are kept alive by storing them in slots of
+// Vector{Any} chunks, these chunks are held in a single root vector which is
+// protected once via the gc_protect callback of the field.
+// Pinning and releasing an element is a single store into a chunk.
+// Copies of an OscarNumber share the slot of the original, which is reference counted,
+// the element is only copied when one of the sharers is about to modify it.
+// Released slots are cleared right away and reused by the next pin.
+// Inside an OscarNumberScope the releases of the current thread are collected and
+// handed back in batches, each under a single lock of the arena, see pending_releases.
+// All public operations but is_unique are serialized by a mutex, so that OscarNumbers
+// of the same field can be used from several (julia-adopted) threads.
+// is_unique only reads the reference count of a slot owned by the caller, so that a field
+// operation takes the lock once, when its result is stored.
+class rooting_arena;
+
+// slots released by the current thread while it is inside an OscarNumberScope
+struct pending_releases {
+   static constexpr size_t batch = 256;
+
+   // nesting depth of the scopes of this thread
+   Int depth = 0;
+   std::vector<std::pair<rooting_arena*, root_slot>> slots;
+
+   void flush();
+
+   static pending_releases& local() {
+      static thread_local pending_releases p;
+      return p;
+   }
+};
+
+class rooting_arena {
+   public:
+      static constexpr uint32_t chunk_size = 4096;
+
+      explicit rooting_arena(const callback<void(jl_value_t*)>& gc_protect_) :
+         gc_protect(gc_protect_) { }
 
-      ~oscar_number_impl() {
-         JL_GC_PUSH1(&julia_elem);
-         //cerr << "free in ~: " << julia_elem << endl;
-         // during global destruction the dispatcher might already be cleaned up
-         // the objects will be deleted anyway once the gc dict is gone
-         if (!in_cleanup)
-            dispatch.gc_free(julia_elem);
+      // exposed: the element is also referenced from julia
+      root_slot pin(jl_value_t* v, bool exposed = false) {
+         ensure_julia_thread();
+         JL_GC_PUSH1(&v);
+         gc_safe_lock lock(mutex);
+         root_slot s = pin_locked(v, exposed);
          JL_GC_POP();
+         return s;
       }
 
-      void destruct() {
-         JL_GC_PUSH1(&julia_elem);
-         //cerr << "free in destruct: " << julia_elem << endl;
-         if (!in_cleanup)
-            dispatch.gc_free(julia_elem);
+      // pins n elements at once, they must be rooted by the caller
+      void pin_many(jl_value_t* const* v, Int n, bool exposed, root_slot* out) {
+         gc_safe_lock lock(mutex);
+         for (Int i = 0; i < n; ++i)
+            out[i] = pin_locked(v[i], exposed);
+      }
+
+      // pins v in s and publishes it in target unless another thread was faster,
+      // returns the published element; readers load target with acquire semantics
+      jl_value_t* publish(jl_value_t*& target, root_slot& s, jl_value_t* v) {
+         ensure_julia_thread();
+         JL_GC_PUSH1(&v);
+         gc_safe_lock lock(mutex);
+         jl_value_t* cur = __atomic_load_n(&target, __ATOMIC_ACQUIRE);
+         if (!cur) {
+            s = pin_locked(v, false);
+            __atomic_store_n(&target, v, __ATOMIC_RELEASE);
+            cur = v;
+         }
          JL_GC_POP();
+         return cur;
       }
 
-      oscar_number_wrap* copy() const {
-         return new oscar_number_impl(this, dispatch.index);
+      void share(root_slot s) {
+         gc_safe_lock lock(mutex);
+         assert(slots[s.index].generation == s.generation);
+         ++slots[s.index].refs;
       }
 
-      oscar_number_wrap* upgrade_to(const oscar_number_dispatch& d) {
-         if (dispatch.index != d.index)
-            throw std::runtime_error("oscar_number_wrap: different julia fields!");
-         // nothing to do, both in the same proper field
-         return this;
+      // nobody else can see the element, it may be modified in place;
+      // the caller owns s, hence nobody can share it concurrently, and a concurrent release
+      // of another owner at worst makes the answer a conservative false
+      bool is_unique(root_slot s) const {
+         const slot_info& info = slots[s.index];
+         return info.refs.load(std::memory_order_acquire) == 1 &&
+                !info.exposed.load(std::memory_order_acquire);
       }
 
-      oscar_number_wrap* upgrade_other(oscar_number_wrap* other) const {
-         return other->upgrade_to(this->dispatch);
+      void expose(root_slot s) {
+         gc_safe_lock lock(mutex);
+         slots[s.index].exposed = true;
       }
 
-      jl_value_t* for_julia() const {
-         return julia_elem;
+      void expose_many(const root_slot* s, Int n) {
+         gc_safe_lock lock(mutex);
+         for (Int i = 0; i < n; ++i)
+            slots[s[i].index].exposed = true;
       }
 
-      double as_float() const {
-         Int inf = this->is_inf();
-         if (__builtin_expect(inf == 0, 1)) {
-            return dispatch.to_float(julia_elem);
+      // replace the element rooted in s by a freshly created one,
+      // a shared slot is left to the other owners and s is moved to a new slot
+      void set(root_slot& s, jl_value_t* v) {
+         ensure_julia_thread();
+         JL_GC_PUSH1(&v);
+         gc_safe_lock lock(mutex);
+         assert(slots[s.index].generation == s.generation);
+         if (slots[s.index].refs > 1) {
+            if (instrumented())
+               ++shared_writes;
+            --slots[s.index].refs;
+            s = pin_locked(v, false);
          } else {
-            return std::numeric_limits<double>::infinity() * static_cast<double>(inf);
+            store(s.index, v);
+            slots[s.index].exposed = false;
          }
+         JL_GC_POP();
       }
 
-      Rational as_rational() const {
-         if (__builtin_expect(this->is_inf() == 0, 1)) {
-            Rational r;
-            mpq_ptr q = dispatch.to_rational(julia_elem);
-            if (q == nullptr) {
-               throw std::runtime_error("OscarNumber: could not convert field element to rational");
-            }
-            r.copy_from(q);
-            return r;
-         } else {
-            return Rational::infinity(infinity);
+      void release(root_slot s) {
+         pending_releases& p = pending_releases::local();
+         if (p.depth > 0) {
+            p.slots.emplace_back(this, s);
+            if (p.slots.size() >= pending_releases::batch)
+               p.flush();
+            return;
          }
+         gc_safe_lock lock(mutex);
+         release_locked(s);
       }
-      const Rational& get_rational() const {
-         // this should not happen
-         throw std::runtime_error("oscar_number_wrap: invalid access to rational");
-      }
-
-      //oscar_number_wrap* add(const oscar_number_wrap* b) {
-      //   jl_value_t* other = b->for_julia();
-      //   //cerr << "pre-add" << endl;
-      //   julia_elem = dispatch.add(julia_elem, other);
-      //   //cerr << "post-add" << endl;
-      //   return this;
-      //} 
-      oscar_number_wrap* add(const oscar_number_wrap* b) {
-         if (__builtin_expect(this->is_inf() == 0, 1)) {
-            if (__builtin_expect(b->is_inf() == 0, 1)) {
-               jl_value_t* res = dispatch.add(julia_elem, b->for_julia());
-               JL_GC_PUSH1(&res);
-               dispatch.gc_protect(res);
-               dispatch.gc_free(julia_elem);
-               julia_elem = res;
-               JL_GC_POP();
-            } else
-               infinity = b->is_inf();
-         } else if (this->is_inf() + b->is_inf() == 0)
-            throw pm::GMP::NaN();
-         return this;
-      }
-
-      oscar_number_wrap* sub(const oscar_number_wrap* b) {
-         if (__builtin_expect(this->is_inf() == 0, 1)) {
-            if (__builtin_expect(b->is_inf() == 0, 1)) {
-               jl_value_t* res = dispatch.sub(julia_elem, b->for_julia());
-               JL_GC_PUSH1(&res);
-               dispatch.gc_protect(res);
-               dispatch.gc_free(julia_elem);
-               julia_elem = res;
-               JL_GC_POP();
-            } else
-               infinity = -b->is_inf();
-         } else if (this->is_inf() - b->is_inf() == 0)
-            throw pm::GMP::NaN();
-         return this;
-      }
-      oscar_number_wrap* mul(const oscar_number_wrap* b) {
-         if (__builtin_expect(this->is_inf() == 0, 1)) {
-            if (__builtin_expect(b->is_inf() == 0, 1)) {
-               jl_value_t* res = dispatch.mul(julia_elem, b->for_julia());
-               JL_GC_PUSH1(&res);
-               dispatch.gc_protect(res);
-               dispatch.gc_free(julia_elem);
-               julia_elem = res;
-               JL_GC_POP();
-            } else {
-               if (this->is_zero())
-                  throw pm::GMP::NaN();
-               infinity = this->sign() * b->is_inf();
+
+      // the slots in [begin, end) all belong to this arena
+      void release_many(const std::pair<rooting_arena*, root_slot>* begin,
+                        const std::pair<rooting_arena*, root_slot>* end) {
+         gc_safe_lock lock(mutex);
+         for (; begin != end; ++begin)
+            release_locked(begin->second);
+      }
+
+      // enclosure of the element in s, false if not yet computed;
+      // it is dropped whenever the slot gets a new element
+      bool enclosure(root_slot s, interval& e) {
+         gc_safe_lock lock(mutex);
+         e = slots[s.index].enclosure;
+         return slots[s.index].enclosed;
+      }
+
+      void set_enclosure(root_slot s, const interval& e) {
+         gc_safe_lock lock(mutex);
+         slots[s.index].enclosure = e;
+         slots[s.index].enclosed = true;
+      }
+
+      // hash of the element in s, false if not yet computed;
+      // it is dropped whenever the slot gets a new element
+      bool hash(root_slot s, size_t& h) {
+         gc_safe_lock lock(mutex);
+         h = slots[s.index].hash;
+         return slots[s.index].hashed;
+      }
+
+      void set_hash(root_slot s, size_t h) {
+         gc_safe_lock lock(mutex);
+         slots[s.index].hash = h;
+         slots[s.index].hashed = true;
+      }
+
+      // how often a shared element was replaced, see set
+      std::atomic<Int> shared_writes{0};
+
+   private:
+      struct slot_info {
+         uint32_t generation = 0;
+         // only written under the lock, read without it by is_unique
+         std::atomic<uint32_t> refs{0};
+         std::atomic<bool> exposed{false};
+         bool enclosed = false;
+         bool hashed = false;
+         interval enclosure;
+         size_t hash;
+      };
+
+      // The slot records are allocated in chunks parallel to the julia chunks, which never move,
+      // so that is_unique can look at a slot while another thread adds a chunk.
+      // A block table of chunks and a fixed table of blocks cover all 2^32 slot indices;
+      // chunks are only added under the lock and published with release stores.
+      class slot_table {
+         public:
+            static constexpr uint32_t chunks_per_block = 1024;
+            static constexpr uint32_t max_blocks = 1024;
+
+            slot_table() = default;
+            slot_table(const slot_table&) = delete;
+            slot_table& operator= (const slot_table&) = delete;
+
+            ~slot_table() {
+               for (auto& b : blocks) {
+                  std::atomic<slot_info*>* block = b.load(std::memory_order_relaxed);
+                  if (!block) break;
+                  for (uint32_t c = 0; c < chunks_per_block; ++c)
+                     delete[] block[c].load(std::memory_order_relaxed);
+                  delete[] block;
+               }
             }
-         } else {
-            if (b->is_zero())
-               throw pm::GMP::NaN();
-            infinity = this->is_inf() * b->sign();
-         }
-         return this;
-      }
-      oscar_number_wrap* div(const oscar_number_wrap* b) {
-         if (__builtin_expect(b->is_zero(), 0))
-            throw pm::GMP::ZeroDivide();
-         if (__builtin_expect(this->is_inf() == 0, 1)) {
-            if (__builtin_expect(b->is_inf() == 0, 1)) {
-               jl_value_t* res = dispatch.div(julia_elem, b->for_julia());
-               JL_GC_PUSH1(&res);
-               dispatch.gc_protect(res);
-               dispatch.gc_free(julia_elem);
-               julia_elem = res;
-               JL_GC_POP();
-            } else {
-               jl_value_t* empty = nullptr;
-               JL_GC_PUSH1(&empty);
-               jl_value_t* zero = dispatch.init(dispatch.index, &empty, 0);
-               dispatch.gc_protect(zero);
-               dispatch.gc_free(julia_elem);
-               julia_elem = zero;
-               JL_GC_POP();
+
+            slot_info& operator[] (uint32_t i) const {
+               const uint32_t c = i / chunk_size;
+               std::atomic<slot_info*>* block = blocks[c / chunks_per_block].load(std::memory_order_acquire);
+               return block[c % chunks_per_block].load(std::memory_order_acquire)[i % chunk_size];
             }
+
+            size_t size() const { return n; }
+
+            void add_chunk() {
+               const size_t c = n / chunk_size;
+               std::atomic<std::atomic<slot_info*>*>& b = blocks[c / chunks_per_block];
+               if (c % chunks_per_block == 0)
+                  b.store(new std::atomic<slot_info*>[chunks_per_block](), std::memory_order_release);
+               b.load(std::memory_order_relaxed)[c % chunks_per_block].store(new slot_info[chunk_size], std::memory_order_release);
+               n += chunk_size;
+            }
+
+         private:
+            std::atomic<std::atomic<slot_info*>*> blocks[max_blocks] = {};
+            size_t n = 0;
+      };
+
+      // v must be rooted by the caller
+      root_slot pin_locked(jl_value_t* v, bool exposed) {
+         uint32_t i;
+         if (!free_slots.empty()) {
+            i = free_slots.back();
+            free_slots.pop_back();
          } else {
-            if (b->is_inf())
-               throw pm::GMP::NaN();
-            infinity *= b->sign();
+            if (top == slots.size())
+               add_chunk();
+            i = top++;
          }
-         return this;
+         store(i, v);
+         slots[i].refs = 1;
+         slots[i].exposed = exposed;
+         return root_slot{ i, slots[i].generation };
       }
 
-      oscar_number_wrap* negate() {
-         //cerr << "pre-sub" << endl;
-         if (this->is_zero())
-            return this;
-         if (__builtin_expect(this->is_inf() == 0, 1)) {
-            jl_value_t* res = dispatch.negate(julia_elem);
-            JL_GC_PUSH1(&res);
-            dispatch.gc_protect(res);
-            dispatch.gc_free(julia_elem);
-            julia_elem = res;
-            JL_GC_POP();
-         } else {
-            infinity = -infinity;
+      void add_chunk() {
+         jl_value_t* r = reinterpret_cast<jl_value_t*>(root);
+         jl_value_t* chunk = nullptr;
+         JL_GC_PUSH2(&r, &chunk);
+         if (!root) {
+            r = reinterpret_cast<jl_value_t*>(jl_alloc_vec_any(0));
+            gc_protect(r);
+            root = reinterpret_cast<jl_array_t*>(r);
          }
-         return this;
-      }
-
-      oscar_number_wrap* pow(Int k) const {
-         //cerr << "pre-pow" << endl;
-         if (__builtin_expect(this->is_inf() == 0, 1))
-            return new oscar_number_impl(dispatch.pow(julia_elem, k), dispatch, std::true_type());
-         else if (k > 0)
-            return oscar_number_wrap::create(
-                     Rational::infinity(k%2 == 0 ? 1 : this->is_inf())
-                   );
-         else if (k == 0)
-            throw pm::GMP::NaN();
-         else
-            return oscar_number_wrap::create(Rational(0));
+         chunk = reinterpret_cast<jl_value_t*>(jl_alloc_vec_any(chunk_size));
+         jl_array_ptr_1d_push(root, chunk);
+         JL_GC_POP();
+         chunks.push_back(reinterpret_cast<jl_array_t*>(chunk));
+         slots.add_chunk();
       }
 
-      Int cmp(const oscar_number_wrap* b) const {
-         //cerr << "pre-cmp" << endl;
-         if (__builtin_expect(this->is_inf() == 0, 1))
-            if (__builtin_expect(b->is_inf() == 0, 1))
-               return dispatch.cmp(julia_elem, b->for_julia());
-         Int res = this->is_inf() - b->is_inf();
-         return res < 0 ? -1 : (res > 0 ? 1 : 0);
+      void store(uint32_t i, jl_value_t* v) {
+         jl_array_ptr_set(chunks[i / chunk_size], i % chunk_size, v);
+         slots[i].enclosed = false;
+         slots[i].hashed = false;
       }
 
-      bool is_zero() const {
-         if (__builtin_expect(this->is_inf() == 0, 1))
-            return dispatch.is_zero(julia_elem);
-         return false;
-      }
-      bool is_one() const {
-         if (__builtin_expect(this->is_inf() == 0, 1))
-            return dispatch.is_one(julia_elem);
-         return false;
+      void clear(uint32_t i) {
+         store(i, nullptr);
+         ++slots[i].generation;
       }
-      Int is_inf() const {
-         return infinity;
+
+      void release_locked(root_slot s) {
+         slot_info& info = slots[s.index];
+         if (__builtin_expect(info.generation != s.generation, 0) || --info.refs > 0)
+            return;
+         clear(s.index);
+         free_slots.push_back(s.index);
       }
-      Int sign() const {
-         if (__builtin_expect(this->is_inf() == 0, 1))
-            return dispatch.sign(julia_elem);
-         else
-            return infinity;
+
+      const callback<void(jl_value_t*)>& gc_protect;
+      jl_array_t* root = nullptr;
+      std::vector<jl_array_t*> chunks;
+      slot_table slots;
+      std::vector<uint32_t> free_slots;
+      // slots below top have been handed out at least once
+      uint32_t top = 0;
+      std::mutex mutex;
+};
+
+void pending_releases::flush() {
+   // consecutive releases mostly belong to the same field
+   auto* const end = slots.data() + slots.size();
+   for (auto* begin = slots.data(); begin != end; ) {
+      auto* next = begin;
+      while (next != end && next->first == begin->first)
+         ++next;
+      begin->first->release_many(begin, next);
+      begin = next;
+   }
+   slots.clear();
+}
+
+struct oscar_number_dispatch;
+
+// rooted julia elements for rational constants which are embedded into the field
+// over and over again (zero, one, homogenizing coordinates, ...), small integers
+// are kept in a fixed table and all other values in a bounded least-recently-used list.
+// The slots are owned by the cache, users take a shared reference and never modify
+// the element in place. Lookups are serialized by a mutex.
+class constant_cache {
+   public:
+      static constexpr Int small_min = -16;
+      static constexpr Int small_max = 16;
+      static constexpr size_t lru_capacity = 256;
+
+      struct entry {
+         jl_value_t* value = nullptr;
+         root_slot slot{0, 0};
+      };
+
+      // the element for the finite rational x, the caller gets its own reference
+      // to the slot and has to release it
+      entry lookup(const oscar_number_dispatch& d, const Rational& x);
+
+      OscarNumberCacheStats statistics() {
+         gc_safe_lock lock(mutex);
+         return stats;
       }
-      oscar_number_wrap* abs_value() const {
-         //cerr << "pre-abs" << endl;
-         if (__builtin_expect(this->is_inf() == 0, 1))
-            return new oscar_number_impl(dispatch.abs(julia_elem), dispatch, std::true_type());
-         return oscar_number_wrap::create(Rational::infinity(1));
+
+   private:
+      static void fill(const oscar_number_dispatch& d, const Rational& x, entry& e);
+
+      entry small[small_max - small_min + 1];
+      std::list<std::pair<Rational, entry>> lru;
+      std::unordered_map<Rational, std::list<std::pair<Rational, entry>>::iterator, pm::hash_func<Rational>> lru_index;
+      OscarNumberCacheStats stats;
+      std::mutex mutex;
+};
+
+// operand of a julia call: the element of a field value, or for a rational the
+// embedded constant, which holds its own reference to the cache slot until the call is
+// done, so that it cannot be evicted by a lookup of another thread in the meantime
+class julia_operand {
+   public:
+      explicit julia_operand(jl_value_t* v) : value(v) {}
+      julia_operand(const oscar_number_dispatch& d, const Rational& x);
+      ~julia_operand();
+
+      julia_operand(const julia_operand&) = delete;
+      julia_operand& operator= (const julia_operand&) = delete;
+
+      operator jl_value_t* () const { return value; }
+
+   private:
+      jl_value_t* value;
+      root_slot slot{0, 0};
+      const oscar_number_dispatch* owner = nullptr;
+};
+
+// counters of the interval filter, updated concurrently
+struct filter_counters {
+   std::atomic<Int> decided{0};
+   std::atomic<Int> undecided{0};
+   std::atomic<Int> enclosures{0};
+};
+
+// public operations of OscarNumber whose total time is counted per field while
+// instrumented, this includes the callbacks they make and everything around them
+// (rooting, demotion, upgrading of rational operands), and the time of nested
+// operations, e.g. of the multiplication inside an add_mul without a fused callback
+enum class operation {
+   add, sub, mul, div, add_rational, sub_rational, mul_rational, div_rational,
+   negate, pow, add_mul, sub_mul, fma, cross_diff, cross_diff_div, dot, sign_of_dot, add_scaled,
+   cmp, cmp_rational, sign, is_zero, count
+};
+
+constexpr const char* operation_names[] = {
+   "+=", "-=", "*=", "/=", "+=Rational", "-=Rational", "*=Rational", "/=Rational",
+   "negate", "pow", "add_mul", "sub_mul", "fma", "cross_diff", "cross_diff_div", "dot", "sign_of_dot", "add_scaled",
+   "cmp", "cmp Rational", "sign", "is_zero"
+};
+static_assert(sizeof(operation_names) / sizeof(operation_names[0]) == size_t(operation::count),
+              "a name is needed for every operation");
+
+// function pointer table for one registered field, the hot operations are called
+// directly without any std::function or virtual indirection, see callback
+struct oscar_number_dispatch {
+      long index = -1;
+      callback<jl_value_t*(long, jl_value_t**, long)>                                init;
+      callback<jl_value_t*(long, jl_value_t**, const mpz_srcptr, const mpz_srcptr)>  init_from_mpz;
+      callback<jl_value_t*(jl_value_t*)>                                             copy;
+      callback<void(jl_value_t*)>                                                    gc_protect;
+      callback<void(jl_value_t*)>                                                    gc_free;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                add;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                sub;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                mul;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                div;
+      callback<jl_value_t*(jl_value_t*, long)>                                       pow;
+      callback<jl_value_t*(jl_value_t*)>                                             negate;
+      callback<long(jl_value_t*, jl_value_t*)>                                       cmp;
+      callback<char*(jl_value_t*)>                                                   to_string;
+      callback<jl_value_t*(char*)>                                                   from_string;
+      callback<bool(jl_value_t*)>                                                    is_zero;
+      callback<bool(jl_value_t*)>                                                    is_one;
+      callback<bool(jl_value_t*)>                                                    is_inf;
+      callback<long(jl_value_t*)>                                                    sign;
+      callback<jl_value_t*(jl_value_t*)>                                             abs;
+      callback<size_t(jl_value_t*)>                                                  hash;
+      callback<mpq_ptr(jl_value_t*)>                                                 to_rational;
+      callback<double(jl_value_t*)>                                                  to_float;
+      // x + a*b, x - a*b and a*b - c*d, null if not provided by the field
+      callback<jl_value_t*(jl_value_t*, jl_value_t*, jl_value_t*)>                   addmul;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*, jl_value_t*)>                   submul;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*, jl_value_t*, jl_value_t*)>      cross_diff;
+      // in-place variants overwriting their first argument, null if not provided by the field
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                add_inplace;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                sub_inplace;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                mul_inplace;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*)>                                div_inplace;
+      callback<jl_value_t*(jl_value_t*)>                                             negate_inplace;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*, jl_value_t*)>                   addmul_inplace;
+      callback<jl_value_t*(jl_value_t*, jl_value_t*, jl_value_t*)>                   submul_inplace;
+      // sum of a[i]*b[i], Vector{Any} of y[i] + c*x[i], sign of the sum of a[i]*b[i];
+      // null if not provided by the field
+      callback<jl_value_t*(jl_value_t**, jl_value_t**, long)>                        dot;
+      callback<jl_value_t*(jl_value_t**, jl_value_t*, jl_value_t**, long)>           axpy;
+      callback<long(jl_value_t**, jl_value_t**, long)>                               sign_dot;
+      // x op num/den for a finite rational, the denominator is 1 for integers;
+      // null if not provided by the field
+      callback<jl_value_t*(jl_value_t*, const mpz_srcptr, const mpz_srcptr)>         add_rational;
+      callback<jl_value_t*(jl_value_t*, const mpz_srcptr, const mpz_srcptr)>         sub_rational;
+      callback<jl_value_t*(jl_value_t*, const mpz_srcptr, const mpz_srcptr)>         mul_rational;
+      callback<jl_value_t*(jl_value_t*, const mpz_srcptr, const mpz_srcptr)>         div_rational;
+      callback<long(jl_value_t*, const mpz_srcptr, const mpz_srcptr)>                cmp_rational;
+      // stores a certified enclosure in lo_hi[0..1], returns false if there is none;
+      // null if not provided by the field
+      callback<bool(jl_value_t*, double*)>                                           enclose;
+      // coefficients of an element with respect to a fixed basis of the field:
+      // coeffs writes up to n of them into initialized mpq_t and returns their total number,
+      // from_coeffs creates the element of the field index from n coefficients,
+      // descriptor returns a string identifying the field and its basis;
+      // null if not provided by the field
+      callback<long(jl_value_t*, mpq_ptr*, long)>                                    coeffs;
+      callback<jl_value_t*(long, const mpq_srcptr*, long)>                           from_coeffs;
+      callback<char*(long)>                                                          descriptor;
+      // true if the element is rational, null if not provided by the field
+      callback<bool(jl_value_t*)>                                                    is_rational;
+      // (a*b - c*d) / p with an exact division, null if not provided by the field
+      callback<jl_value_t*(jl_value_t*, jl_value_t*, jl_value_t*, jl_value_t*, jl_value_t*)> cross_diff_div;
+
+      // real quadratic field Q(sqrt(quadratic_root)) computed natively in C++,
+      // the julia callbacks are then only used to convert elements
+      bool native = false;
+      Rational quadratic_root;
+
+      // roots of all elements of this field
+      std::unique_ptr<rooting_arena> roots;
+      // upgraded rational constants, rooted in the arena above
+      mutable constant_cache constants;
+      // how often sign, is_zero and cmp were decided by the enclosures
+      mutable filter_counters filter;
+      // rationals upgraded to elements of this field, only counted while instrumented
+      mutable std::atomic<Int> upgrades{0};
+      // field elements converted back to rationals, only counted while instrumented
+      mutable std::atomic<Int> demotions{0};
+      // calls and total time of the public operations, only counted while instrumented
+      mutable call_counter operations[size_t(operation::count)];
+};
+
+// adds the time until its destruction to the counter of a public operation,
+// does nothing for rationals (d == nullptr) or when not instrumented
+class operation_timer {
+   public:
+      operation_timer(const oscar_number_dispatch* d, operation op) :
+         c(d && instrumented() ? &d->operations[size_t(op)] : nullptr) {
+         if (c)
+            start = std::chrono::steady_clock::now();
       }
-      size_t hash() const {
-         if (is_inf())
-            return 0;
-         return dispatch.hash(julia_elem);
+      ~operation_timer() {
+         if (c) {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            c->calls.fetch_add(1, std::memory_order_relaxed);
+            c->ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                            std::memory_order_relaxed);
+         }
       }
 
-      bool uses_rational() const {
-         return false;
-      }
-      long index() const {
-         return dispatch.index;
+      operation_timer(const operation_timer&) = delete;
+      operation_timer& operator= (const operation_timer&) = delete;
+
+   private:
+      call_counter* const c;
+      std::chrono::steady_clock::time_point start;
+};
+
+// Dense registry indexed by the field index, index 0 is reserved for the rationals.
+// It only grows: the tables are allocated in chunks which are never moved or freed,
+// since OscarNumber objects point to them, so a lookup is a pair of atomic loads
+// without any lock.  Only registrations are serialized by a mutex, no julia calls
+// are made while holding it.
+class dispatch_registry {
+   public:
+      static constexpr size_t chunk_size = 1024;
+      static constexpr size_t max_chunks = 1024;
+
+      const oscar_number_dispatch* find(long index) const {
+         if (index <= 0 || size_t(index) >= chunk_size * max_chunks)
+            return nullptr;
+         const chunk* c = chunks[index / chunk_size].load(std::memory_order_acquire);
+         return c ? (*c)[index % chunk_size].load(std::memory_order_acquire) : nullptr;
       }
 
-      std::string to_string() const {
-         std::ostringstream str("");
-         if (__builtin_expect(this->is_inf() == 0, 1)) {
-            char* cstr = dispatch.to_string(julia_elem);
-            str << "(" << cstr << ")";
-         } else {
-            str << (infinity > 0 ? "inf" : "-inf");
+      // false if the index is out of range or already taken, d is left untouched then
+      bool add(long index, std::unique_ptr<oscar_number_dispatch>& d) {
+         if (index <= 0 || size_t(index) >= chunk_size * max_chunks)
+            return false;
+         std::lock_guard<std::mutex> lock(mutex);
+         chunk* c = chunks[index / chunk_size].load(std::memory_order_relaxed);
+         if (!c) {
+            c = new chunk();
+            chunks[index / chunk_size].store(c, std::memory_order_release);
          }
-         return str.str();
+         std::atomic<oscar_number_dispatch*>& entry = (*c)[index % chunk_size];
+         if (entry.load(std::memory_order_relaxed))
+            return false;
+         entry.store(d.release(), std::memory_order_release);
+         return true;
       }
 
    private:
-      const oscar_number_dispatch& dispatch;
-      jl_value_t* julia_elem = nullptr;
-      Int infinity = 0;
-
-   friend class oscar_number_rational_impl;
+      using chunk = std::array<std::atomic<oscar_number_dispatch*>, chunk_size>;
+      std::atomic<chunk*> chunks[max_chunks] = {};
+      std::mutex mutex;
 };
 
-class oscar_number_rational_impl : Rational, public oscar_number_wrap {
-public:
-   oscar_number_rational_impl(const Rational& r) : Rational(r) { }
+static dispatch_registry oscar_number_registry;
 
-   oscar_number_rational_impl() = delete;
+static std::atomic<bool> in_cleanup{false};
 
-   ~oscar_number_rational_impl() { }
+const oscar_number_dispatch& get_dispatch(long index) {
+   const oscar_number_dispatch* d = oscar_number_registry.find(index);
+   if (__builtin_expect(!d, 0))
+      throw std::runtime_error("polymake::OscarNumber: unknown field index");
+   return *d;
+}
 
-   oscar_number_wrap* copy() const {
-      return new oscar_number_rational_impl(Rational(*this));
-   }
+void enter_rooting_scope() {
+   ++pending_releases::local().depth;
+}
 
-   void destruct() { }
+void leave_rooting_scope() {
+   pending_releases& p = pending_releases::local();
+   if (--p.depth > 0)
+      return;
+   if (in_cleanup)
+      p.slots.clear();
+   else
+      p.flush();
+}
 
-   oscar_number_wrap* upgrade_other(oscar_number_wrap* other) const {
-      // this should not be called
-      throw std::runtime_error("oscar_number_wrap: error upgrading to rational element");
-   }
+template <typename Signature>
+void set_callback(callback<Signature>& target, void* fptr) {
+   target = reinterpret_cast<Signature*>(fptr);
+}
 
-   oscar_number_wrap* upgrade_to(const oscar_number_dispatch& d) {
-      return new oscar_number_impl(static_cast<const Rational &>(*this), d);
+// creates a new, not yet protected, julia element for a finite rational number
+jl_value_t* julia_from_rational(const oscar_number_dispatch& d, const Rational& x) {
+   ensure_julia_thread();
+   jl_value_t* res = nullptr;
+   jl_value_t* empty = nullptr;
+   JL_GC_PUSH2(&res, &empty);
+   if (x.is_integral() && numerator(x).fits_into_Int()) {
+      res = d.init(d.index, &empty, static_cast<Int>(x));
+   } else {
+      res = d.init_from_mpz(d.index, &empty, numerator(x).get_rep(), denominator(x).get_rep());
    }
+   JL_GC_POP();
+   return res;
+}
 
-   jl_value_t* for_julia() const {
-      // we should probably never end up here
-      throw std::runtime_error("oscar_number_rational: not implemented");
-      //return (jl_value_t*) nullptr;
-   }
+void constant_cache::fill(const oscar_number_dispatch& d, const Rational& x, entry& e) {
+   e.value = julia_from_rational(d, x);
+   e.slot = d.roots->pin(e.value);
+}
 
-   const Rational& get_rational() const {
-      return (const Rational&) *this;
+constant_cache::entry constant_cache::lookup(const oscar_number_dispatch& d, const Rational& x) {
+   gc_safe_lock lock(mutex);
+   entry* e = nullptr;
+   if (x.is_integral() && numerator(x).fits_into_Int()) {
+      const Int i = static_cast<Int>(x);
+      if (i >= small_min && i <= small_max) {
+         e = &small[i - small_min];
+         if (e->value) {
+            ++stats.small_hits;
+         } else {
+            ++stats.misses;
+            fill(d, x, *e);
+         }
+      }
    }
-
-   Rational as_rational() const {
-      return Rational(*this);
+   if (!e) {
+      auto it = lru_index.find(x);
+      if (it != lru_index.end()) {
+         ++stats.lru_hits;
+         lru.splice(lru.begin(), lru, it->second);
+      } else {
+         ++stats.misses;
+         if (lru.size() == lru_capacity) {
+            d.roots->release(lru.back().second.slot);
+            lru_index.erase(lru.back().first);
+            lru.pop_back();
+            ++stats.evictions;
+         }
+         entry fresh;
+         fill(d, x, fresh);
+         lru.emplace_front(x, fresh);
+         lru_index.emplace(x, lru.begin());
+      }
+      e = &lru.front().second;
    }
+   d.roots->share(e->slot);
+   return *e;
+}
 
-   double as_float() const {
-      return static_cast<double>(*this);
-   }
+julia_operand::julia_operand(const oscar_number_dispatch& d, const Rational& x) {
+   const auto c = d.constants.lookup(d, x);
+   value = c.value;
+   slot = c.slot;
+   owner = &d;
+}
 
-   oscar_number_wrap* negate() {
-      Rational::negate();
-      return this;
-   }
-   oscar_number_wrap* add(const oscar_number_wrap* other) {
-      Rational::operator+=(other->get_rational());
-      return this;
-   }
-   oscar_number_wrap* sub(const oscar_number_wrap* other) {
-      Rational::operator-=(other->get_rational());
-      return this;
-   }
-   oscar_number_wrap* mul(const oscar_number_wrap* other) {
-      Rational::operator*=(other->get_rational());
-      return this;
-   }
-   oscar_number_wrap* div(const oscar_number_wrap* other) {
-      Rational::operator/=(other->get_rational());
-      return this;
-   }
-   oscar_number_wrap* pow(Int p) const {
-      return new oscar_number_rational_impl(Rational::pow(*this, p));
-   }
-   Int cmp(const oscar_number_wrap* other) const {
-      return this->compare(other->get_rational());
-   }
-   bool is_zero() const {
-      return Rational::is_zero();
-   }
-   bool is_one() const {
-      return pm::is_one((Rational) *this);
-   }
-   Int is_inf() const {
-      return pm::isinf(*this);
-   }
-   Int sign() const {
-      return pm::sign(*this);
-   }
-   oscar_number_wrap* abs_value() const {
-      return new oscar_number_rational_impl(abs(static_cast<Rational>(*this)));
-   }
-   size_t hash() const {
-      static auto hashfun = pm::hash_func<Rational>();
-      return hashfun(static_cast<Rational>(*this));
-   }
+julia_operand::~julia_operand() {
+   if (owner && !in_cleanup)
+      owner->roots->release(slot);
+}
 
-   bool uses_rational() const {
+// enclosure of the finite element v rooted in s, computed on first use;
+// false if the field cannot provide enclosures
+bool enclosure_of(const oscar_number_dispatch& d, root_slot s, jl_value_t* v, interval& e) {
+   if (!d.enclose)
+      return false;
+   if (d.roots->enclosure(s, e))
       return true;
+   double lo_hi[2];
+   ++d.filter.enclosures;
+   if (!d.enclose(v, lo_hi) || !(lo_hi[0] <= lo_hi[1])) {
+      // remember that there is no usable enclosure, this one never decides anything
+      lo_hi[0] = -std::numeric_limits<double>::infinity();
+      lo_hi[1] = std::numeric_limits<double>::infinity();
    }
-   long index() const {
-      return 0;
-   }
+   e = interval{ lo_hi[0], lo_hi[1] };
+   d.roots->set_enclosure(s, e);
+   return true;
+}
 
-   std::string to_string() const {
-      std::ostringstream str;
-      str << "(";
-      if (__builtin_expect(this->is_inf() == 0, 1)) {
-         str << numerator(*this);
-         if (!Rational::is_integral()) {
-            str << "//";
-            str << denominator(*this);
+// sign of the value enclosed by e, 2 if undecided
+Int sign_of(const interval& e) {
+   if (e.lo > 0) return 1;
+   if (e.hi < 0) return -1;
+   if (e.lo == 0 && e.hi == 0) return 0;
+   return 2;
+}
+
+// comparison of the values enclosed by a and b, 2 if undecided
+Int cmp_of(const interval& a, const interval& b) {
+   if (a.hi < b.lo) return -1;
+   if (a.lo > b.hi) return 1;
+   if (a.lo == a.hi && b.lo == b.hi && a.lo == b.lo) return 0;
+   return 2;
+}
+
+// enclosure of a finite rational, the conversion to double is off by less than one ulp
+interval enclosure_of(const Rational& r) {
+   if (pm::is_zero(r))
+      return interval{ 0, 0 };
+   const double x = double(r);
+   return interval{ std::nextafter(x, -std::numeric_limits<double>::infinity()),
+                    std::nextafter(x, std::numeric_limits<double>::infinity()) };
+}
+
+// x op b for a finite rational b, without creating a julia element for b
+// if the field provides the mixed operation
+jl_value_t* julia_op_rational(const callback<jl_value_t*(jl_value_t*, const mpz_srcptr, const mpz_srcptr)>& op_rational,
+                              const callback<jl_value_t*(jl_value_t*, jl_value_t*)>& op,
+                              const oscar_number_dispatch& d, jl_value_t* x, const Rational& b) {
+   if (op_rational)
+      return op_rational(x, numerator(b).get_rep(), denominator(b).get_rep());
+   jl_value_t* bv = julia_from_rational(d, b);
+   JL_GC_PUSH1(&bv);
+   jl_value_t* res = op(x, bv);
+   JL_GC_POP();
+   return res;
+}
+
+// initialized mpq_t for exchanging coefficient vectors with julia
+class mpq_buffer {
+   public:
+      mpq_buffer() = default;
+      mpq_buffer(const mpq_buffer&) = delete;
+      ~mpq_buffer() {
+         for (auto& q : values)
+            mpq_clear(&q);
+      }
+
+      void resize(size_t n) {
+         if (n > values.size()) {
+            const size_t old = values.size();
+            values.resize(n);
+            for (size_t i = old; i < n; ++i)
+               mpq_init(&values[i]);
          }
-      } else {
-         str << (Rational) *this;
+         ptrs.resize(n);
+         for (size_t i = 0; i < n; ++i)
+            ptrs[i] = &values[i];
       }
-      str << ")";
-      return str.str();
-   }
 
-private:
-   //static oscar_number_wrap* from_string(const std::string& s);
+      mpq_ptr* data() { return ptrs.data(); }
+      const mpq_srcptr* const_data() const { return ptrs.data(); }
+
+   private:
+      // the elements are never moved after initialization, see resize
+      std::deque<__mpq_struct> values;
+      std::vector<mpq_ptr> ptrs;
 };
 
-oscar_number_wrap* oscar_number_wrap::create(const Rational& r) {
-   return new oscar_number_rational_impl(r);
+} // end juliainterface
+
+using juliainterface::oscar_number_dispatch;
+using juliainterface::in_cleanup;
+using juliainterface::root_slot;
+
+// internal helpers
+
+OscarNumber::OscarNumber(jl_value_t* v, const oscar_number_dispatch& d, bool fresh) :
+   dispatch(&d) {
+   elem.julia_elem = v;
+   elem.slot = dispatch->roots->pin(v, !fresh);
+   elem.infinity = 0;
 }
 
-oscar_number_wrap* oscar_number_wrap::create(void* e, long index) {
-   return new oscar_number_impl(reinterpret_cast<jl_value_t*>(e), index);
+bool OscarNumber::julia_elem_unique() const {
+   return dispatch->roots->is_unique(elem.slot);
 }
 
-void oscar_number_wrap::destroy(oscar_number_wrap* j) {
-   delete j;
+OscarNumber::OscarNumber(QuadraticExtension<Rational>&& v, const oscar_number_dispatch& d) :
+   dispatch(&d) {
+   elem.julia_elem = nullptr;
+   elem.infinity = 0;
+   elem.native = new QuadraticExtension<Rational>(std::move(v));
 }
 
-using onptr = std::unique_ptr<oscar_number_wrap, void (*)(oscar_number_wrap*)>;
+QuadraticExtension<Rational>& OscarNumber::native_for_update() {
+   if (elem.julia_elem) {
+      dispatch->roots->release(elem.slot);
+      elem.julia_elem = nullptr;
+   }
+   return *elem.native;
+}
+
+jl_value_t* OscarNumber::materialize() const {
+   jl_value_t* v = __atomic_load_n(&elem.julia_elem, __ATOMIC_ACQUIRE);
+   if (!v) {
+      mpq_srcptr c[2] = { elem.native->a().get_rep(), elem.native->b().get_rep() };
+      v = dispatch->from_coeffs(dispatch->index, c, 2);
+      // only a cache of the value, like the enclosures and hashes of julia elements;
+      // concurrent readers may both get here, the first one publishes its element
+      OscarNumber& self = const_cast<OscarNumber&>(*this);
+      v = dispatch->roots->publish(self.elem.julia_elem, self.elem.slot, v);
+   }
+   return v;
+}
 
-onptr maybe_upgrade(onptr& a, const onptr& b) {
-   if (b->uses_rational() && !a->uses_rational()) {
-      onptr bc(b->copy(), &oscar_number_wrap::destroy);
-      bc = std::move(onptr(a->upgrade_other(bc.get()), &oscar_number_wrap::destroy));
-      return std::move(bc);
-   } else if (a->uses_rational() && !b->uses_rational())
-      a = std::move(onptr(b->upgrade_other(a.get()), &oscar_number_wrap::destroy));
-   else if (a->index() != b->index() && a->index() * b->index() != 0)
+void OscarNumber::upgrade_to(const oscar_number_dispatch& d) {
+   if (juliainterface::instrumented())
+      ++d.upgrades;
+   Int inf = isinf(rational);
+   if (d.native) {
+      auto* v = new QuadraticExtension<Rational>(__builtin_expect(inf == 0, 1) ? rational : Rational(1));
+      rational.~Rational();
+      dispatch = &d;
+      elem.julia_elem = nullptr;
+      elem.infinity = inf;
+      elem.native = v;
+      return;
+   }
+   // the element is shared with the constant cache and copied once it is modified
+   const auto c = d.constants.lookup(d, __builtin_expect(inf == 0, 1) ? rational : Rational(1));
+   jl_value_t* v = c.value;
+   root_slot slot = c.slot;
+   rational.~Rational();
+   dispatch = &d;
+   elem.julia_elem = v;
+   elem.slot = slot;
+   elem.infinity = inf;
+}
+
+void OscarNumber::demote_if_rational() {
+   if (!dispatch || elem.infinity != 0)
+      return;
+   Rational r;
+   if (dispatch->native) {
+      if (!pm::is_zero(elem.native->b()))
+         return;
+      r = elem.native->a();
+   } else {
+      if (!dispatch->is_rational || !dispatch->is_rational(elem.julia_elem))
+         return;
+      mpq_ptr q = dispatch->to_rational(elem.julia_elem);
+      if (!q)
+         return;
+      r.copy_from(q);
+   }
+   if (juliainterface::instrumented())
+      ++dispatch->demotions;
+   release();
+   dispatch = nullptr;
+   new(&rational) Rational(std::move(r));
+}
+
+void OscarNumber::prepare_binary(const OscarNumber& b) {
+   if (!dispatch)
+      upgrade_to(*b.dispatch);
+   else if (b.dispatch && b.dispatch != dispatch)
       throw std::runtime_error("oscar_number_wrap: different julia fields!");
-   return std::move(onptr(nullptr, &oscar_number_wrap::destroy));
 }
 
-} // end juliainterface
+juliainterface::julia_operand OscarNumber::julia_value_in(const oscar_number_dispatch& d) const {
+   if (dispatch)
+      return juliainterface::julia_operand(elem.julia_elem);
+   return juliainterface::julia_operand(d, rational);
+}
 
-using juliainterface::onptr;
+void OscarNumber::replace_julia_elem(jl_value_t* res) {
+   // the slot now roots the result, the old element is dropped
+   dispatch->roots->set(elem.slot, res);
+   elem.julia_elem = res;
+}
+
+const oscar_number_dispatch* OscarNumber::common_field(std::initializer_list<const OscarNumber*> ops) {
+   const oscar_number_dispatch* d = nullptr;
+   for (const OscarNumber* op : ops) {
+      if (op->dispatch) {
+         if (d && d != op->dispatch)
+            throw std::runtime_error("oscar_number_wrap: different julia fields!");
+         d = op->dispatch;
+      }
+   }
+   return d;
+}
+
+void OscarNumber::release() {
+   if (dispatch) {
+      // during global destruction the dispatcher might already be cleaned up
+      // the objects will be deleted anyway once the gc dict is gone
+      // moved-from elements do not own a julia element anymore
+      if (elem.julia_elem && !in_cleanup)
+         dispatch->roots->release(elem.slot);
+      if (dispatch->native)
+         delete elem.native;
+   } else {
+      rational.~Rational();
+   }
+}
+
+void OscarNumber::steal(OscarNumber& b) noexcept {
+   dispatch = b.dispatch;
+   if (dispatch) {
+      elem = b.elem;
+      b.elem.julia_elem = nullptr;
+      b.elem.native = nullptr;
+   } else {
+      new(&rational) Rational(std::move(b.rational));
+   }
+}
 
 // implementations for on class
 OscarNumber::OscarNumber() :
-   OscarNumber(Rational(0)) {}
+   dispatch(nullptr), rational(0) {}
 
-//OscarNumber::~OscarNumber() = default;
+OscarNumber::~OscarNumber() {
+   release();
+}
 
 OscarNumber::OscarNumber(const Rational& r) :
-   impl(juliainterface::oscar_number_wrap::create(r), &juliainterface::oscar_number_wrap::destroy) {}
+   dispatch(nullptr), rational(r) {}
 
 OscarNumber::OscarNumber(const OscarNumber& on) :
-   impl(on.impl->copy(), &juliainterface::oscar_number_wrap::destroy) {
-   //cerr << "copied" << endl;
+   dispatch(on.dispatch) {
+   if (dispatch && dispatch->native) {
+      // the julia copy of the value is not shared, it is created again on demand
+      elem.julia_elem = nullptr;
+      elem.infinity = on.elem.infinity;
+      elem.native = new QuadraticExtension<Rational>(*on.elem.native);
+   } else if (dispatch) {
+      // no julia call, the element is shared until one of the copies changes
+      elem = on.elem;
+      dispatch->roots->share(elem.slot);
+   } else {
+      new(&rational) Rational(on.rational);
+   }
 }
 
-OscarNumber::OscarNumber(OscarNumber&& on) :
-   impl(std::move(on.impl)) {
-   //cerr << "moved" << endl;
+OscarNumber::OscarNumber(OscarNumber&& on) noexcept {
+   steal(on);
 }
 
 OscarNumber::OscarNumber(void* jv, Int index) :
-   impl(juliainterface::oscar_number_wrap::create(jv, index), &juliainterface::oscar_number_wrap::destroy) {}
+   dispatch(&juliainterface::get_dispatch(index)) {
+   if (dispatch->native) {
+      juliainterface::mpq_buffer c;
+      c.resize(2);
+      const long n = dispatch->coeffs(reinterpret_cast<jl_value_t*>(jv), c.data(), 2);
+      if (n > 2)
+         throw std::runtime_error("OscarNumber: element of a quadratic field with more than two coefficients");
+      Rational a, b;
+      a.copy_from(c.data()[0]);
+      b.copy_from(c.data()[1]);
+      elem.julia_elem = nullptr;
+      elem.infinity = 0;
+      elem.native = new QuadraticExtension<Rational>(a, b, dispatch->quadratic_root);
+      return;
+   }
+   elem.julia_elem = dispatch->copy(reinterpret_cast<jl_value_t*>(jv));
+   elem.slot = dispatch->roots->pin(elem.julia_elem);
+   elem.infinity = 0;
+}
 
 OscarNumber& OscarNumber::operator= (const Rational& b) {
-   impl = std::move(onptr(juliainterface::oscar_number_wrap::create(b), &juliainterface::oscar_number_wrap::destroy));
+   if (dispatch) {
+      release();
+      dispatch = nullptr;
+      new(&rational) Rational(b);
+   } else {
+      rational = b;
+   }
    return *this;
 }
 
-OscarNumber::OscarNumber(juliainterface::oscar_number_wrap* on) :
-   impl(on, &juliainterface::oscar_number_wrap::destroy) {}
-
 OscarNumber& OscarNumber::operator= (const OscarNumber& b) {
-   impl = std::move(onptr(b.impl->copy(), &juliainterface::oscar_number_wrap::destroy));
+   if (this != &b) {
+      if (!dispatch && !b.dispatch) {
+         rational = b.rational;
+      } else {
+         OscarNumber tmp(b);
+         release();
+         steal(tmp);
+      }
+   }
    return *this;
 }
 
+OscarNumber& OscarNumber::operator= (OscarNumber&& b) {
+   if (this != &b) {
+      if (!dispatch && !b.dispatch) {
+         rational = std::move(b.rational);
+      } else {
+         release();
+         steal(b);
+      }
+   }
+   return *this;
+}
+
+// mixed operations with rationals never create a temporary OscarNumber,
+// trivial operands are handled without calling julia at all
+
 OscarNumber& OscarNumber::operator+= (const Rational& b) {
-   return *this += OscarNumber(b);
+   if (!dispatch) {
+      rational += b;
+      return *this;
+   }
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::add_rational);
+   const Int b_inf = isinf(b);
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         if (pm::is_zero(b))
+            return *this;
+         if (dispatch->native)
+            native_for_update() += b;
+         else
+            replace_julia_elem(juliainterface::julia_op_rational(dispatch->add_rational, dispatch->add,
+                                                                 *dispatch, elem.julia_elem, b));
+      } else
+         elem.infinity = b_inf;
+   } else if (elem.infinity + b_inf == 0)
+      throw pm::GMP::NaN();
+   return *this;
 }
 OscarNumber& OscarNumber::operator-= (const Rational& b) {
-   return *this -= OscarNumber(b);
+   if (!dispatch) {
+      rational -= b;
+      return *this;
+   }
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::sub_rational);
+   const Int b_inf = isinf(b);
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         if (pm::is_zero(b))
+            return *this;
+         if (dispatch->native)
+            native_for_update() -= b;
+         else
+            replace_julia_elem(juliainterface::julia_op_rational(dispatch->sub_rational, dispatch->sub,
+                                                                 *dispatch, elem.julia_elem, b));
+      } else
+         elem.infinity = -b_inf;
+   } else if (elem.infinity - b_inf == 0)
+      throw pm::GMP::NaN();
+   return *this;
 }
 OscarNumber& OscarNumber::operator*= (const Rational& b) {
-   return *this *= OscarNumber(b);
+   if (!dispatch) {
+      rational *= b;
+      return *this;
+   }
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::mul_rational);
+   const Int b_inf = isinf(b);
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         if (pm::is_one(b))
+            return *this;
+         if (b.is_integral() && numerator(b) == -1)
+            return negate();
+         if (dispatch->native)
+            native_for_update() *= b;
+         else
+            replace_julia_elem(juliainterface::julia_op_rational(dispatch->mul_rational, dispatch->mul,
+                                                                 *dispatch, elem.julia_elem, b));
+      } else {
+         if (this->is_zero())
+            throw pm::GMP::NaN();
+         elem.infinity = this->sign() * b_inf;
+      }
+   } else {
+      if (pm::is_zero(b))
+         throw pm::GMP::NaN();
+      elem.infinity *= pm::sign(b);
+   }
+   return *this;
 }
 OscarNumber& OscarNumber::operator/= (const Rational& b) {
-   return *this /= OscarNumber(b);
-}
-//OscarNumber& OscarNumber::operator+= (const Rational& r){
-//   auto jfr = juliainterface::oscar_number_wrap::create(r);
-//   if (impl->uses_rational()) {
-//      impl->add(jfr);
-//   } else {
-//      auto on = impl->upgrade_other(jfr);
-//      impl->add(on);
-//      delete on;
-//   }
-//   delete jfr;
-//   return *this;
-//}
-//OscarNumber& OscarNumber::operator-= (const Rational& r){
-//   impl->sub(juliainterface::oscar_number_wrap::create(r));
-//   return *this;
-//}
-//OscarNumber& OscarNumber::operator*= (const Rational& r){
-//   impl->mul(juliainterface::oscar_number_wrap::create(r));
-//   return *this;
-//}
-//OscarNumber& OscarNumber::operator/= (const Rational& r){
-//   impl->div(juliainterface::oscar_number_wrap::create(r));
-//   return *this;
-//}
+   if (!dispatch) {
+      rational /= b;
+      return *this;
+   }
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::div_rational);
+   if (__builtin_expect(pm::is_zero(b), 0))
+      throw pm::GMP::ZeroDivide();
+   const Int b_inf = isinf(b);
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         if (pm::is_one(b))
+            return *this;
+         if (b.is_integral() && numerator(b) == -1)
+            return negate();
+         if (dispatch->native)
+            native_for_update() /= b;
+         else
+            replace_julia_elem(juliainterface::julia_op_rational(dispatch->div_rational, dispatch->div,
+                                                                 *dispatch, elem.julia_elem, b));
+      } else if (dispatch->native) {
+         native_for_update() = QuadraticExtension<Rational>();
+      } else {
+         replace_julia_elem(juliainterface::julia_from_rational(*dispatch, Rational(0)));
+      }
+   } else {
+      if (b_inf)
+         throw pm::GMP::NaN();
+      elem.infinity *= pm::sign(b);
+   }
+   return *this;
+}
+
+// arithmetic on finite elements of the same field, without any checks;
+// also used directly by OscarNumberT
+void OscarNumber::field_add(const OscarNumber& b) {
+   if (dispatch->native) {
+      native_for_update() += *b.elem.native;
+      return;
+   }
+   juliainterface::ensure_julia_thread();
+   jl_value_t* bv = b.elem.julia_elem;
+   JL_GC_PUSH1(&bv);
+   jl_value_t* res = julia_elem_unique() && dispatch->add_inplace
+                     ? dispatch->add_inplace(elem.julia_elem, bv)
+                     : dispatch->add(elem.julia_elem, bv);
+   JL_GC_POP();
+   replace_julia_elem(res);
+}
+
+void OscarNumber::field_sub(const OscarNumber& b) {
+   if (dispatch->native) {
+      native_for_update() -= *b.elem.native;
+      return;
+   }
+   juliainterface::ensure_julia_thread();
+   jl_value_t* bv = b.elem.julia_elem;
+   JL_GC_PUSH1(&bv);
+   jl_value_t* res = julia_elem_unique() && dispatch->sub_inplace
+                     ? dispatch->sub_inplace(elem.julia_elem, bv)
+                     : dispatch->sub(elem.julia_elem, bv);
+   JL_GC_POP();
+   replace_julia_elem(res);
+}
+
+void OscarNumber::field_mul(const OscarNumber& b) {
+   if (dispatch->native) {
+      // b may be this object
+      native_for_update() *= QuadraticExtension<Rational>(*b.elem.native);
+      return;
+   }
+   juliainterface::ensure_julia_thread();
+   jl_value_t* bv = b.elem.julia_elem;
+   JL_GC_PUSH1(&bv);
+   jl_value_t* res = julia_elem_unique() && dispatch->mul_inplace
+                     ? dispatch->mul_inplace(elem.julia_elem, bv)
+                     : dispatch->mul(elem.julia_elem, bv);
+   JL_GC_POP();
+   replace_julia_elem(res);
+}
+
+void OscarNumber::field_div(const OscarNumber& b) {
+   if (dispatch->native) {
+      // b may be this object
+      native_for_update() /= QuadraticExtension<Rational>(*b.elem.native);
+      return;
+   }
+   juliainterface::ensure_julia_thread();
+   jl_value_t* bv = b.elem.julia_elem;
+   JL_GC_PUSH1(&bv);
+   jl_value_t* res = julia_elem_unique() && dispatch->div_inplace
+                     ? dispatch->div_inplace(elem.julia_elem, bv)
+                     : dispatch->div(elem.julia_elem, bv);
+   JL_GC_POP();
+   replace_julia_elem(res);
+}
 
 OscarNumber& OscarNumber::operator+= (const OscarNumber& b){
-   auto bic = juliainterface::maybe_upgrade(impl, b.impl);
-   impl->add(bic ? bic.get() : b.impl.get());
+   if (!b.dispatch)
+      return *this += b.rational;
+   const juliainterface::operation_timer timer(b.dispatch, juliainterface::operation::add);
+   prepare_binary(b);
+   const Int b_inf = b.is_inf();
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         field_add(b);
+         demote_if_rational();
+      } else
+         elem.infinity = b_inf;
+   } else if (elem.infinity + b_inf == 0)
+      throw pm::GMP::NaN();
    return *this;
 }
 OscarNumber& OscarNumber::operator-= (const OscarNumber& b){
-   auto bic = juliainterface::maybe_upgrade(impl, b.impl);
-   impl->sub(bic ? bic.get() : b.impl.get());
+   if (!b.dispatch)
+      return *this -= b.rational;
+   const juliainterface::operation_timer timer(b.dispatch, juliainterface::operation::sub);
+   prepare_binary(b);
+   const Int b_inf = b.is_inf();
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         field_sub(b);
+         demote_if_rational();
+      } else
+         elem.infinity = -b_inf;
+   } else if (elem.infinity - b_inf == 0)
+      throw pm::GMP::NaN();
    return *this;
 }
 OscarNumber& OscarNumber::operator*= (const OscarNumber& b){
-   auto bic = juliainterface::maybe_upgrade(impl, b.impl);
-   impl->mul(bic ? bic.get() : b.impl.get());
+   if (!b.dispatch)
+      return *this *= b.rational;
+   const juliainterface::operation_timer timer(b.dispatch, juliainterface::operation::mul);
+   prepare_binary(b);
+   const Int b_inf = b.is_inf();
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         field_mul(b);
+         demote_if_rational();
+      } else {
+         if (this->is_zero())
+            throw pm::GMP::NaN();
+         elem.infinity = this->sign() * b_inf;
+      }
+   } else {
+      if (b.is_zero())
+         throw pm::GMP::NaN();
+      elem.infinity *= b.sign();
+   }
    return *this;
 }
 OscarNumber& OscarNumber::operator/= (const OscarNumber& b){
-   auto bic = juliainterface::maybe_upgrade(impl, b.impl);
-   impl->div(bic ? bic.get() : b.impl.get());
+   if (!b.dispatch)
+      return *this /= b.rational;
+   const juliainterface::operation_timer timer(b.dispatch, juliainterface::operation::div);
+   if (__builtin_expect(b.is_zero(), 0))
+      throw pm::GMP::ZeroDivide();
+   prepare_binary(b);
+   const Int b_inf = b.is_inf();
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (__builtin_expect(b_inf == 0, 1)) {
+         field_div(b);
+         demote_if_rational();
+      } else if (dispatch->native) {
+         native_for_update() = QuadraticExtension<Rational>();
+      } else {
+         replace_julia_elem(juliainterface::julia_from_rational(*dispatch, Rational(0)));
+      }
+   } else {
+      if (b_inf)
+         throw pm::GMP::NaN();
+      elem.infinity *= b.sign();
+   }
    return *this;
+}
+
+OscarNumber& OscarNumber::reverse_sub(const OscarNumber& a) {
+   if (dispatch && a.dispatch == dispatch && !elem.infinity && !a.elem.infinity) {
+      const juliainterface::operation_timer timer(dispatch, juliainterface::operation::sub);
+      if (dispatch->native) {
+         QuadraticExtension<Rational> diff = *a.elem.native - *elem.native;
+         native_for_update() = std::move(diff);
+      } else {
+         replace_julia_elem(dispatch->sub(a.elem.julia_elem, elem.julia_elem));
+      }
+      demote_if_rational();
+      return *this;
+   }
+   // rationals, infinities and mixed operands
+   return negate() += a;
+}
+
+OscarNumber& OscarNumber::reverse_div(const OscarNumber& a) {
+   if (dispatch && a.dispatch == dispatch && !elem.infinity && !a.elem.infinity) {
+      if (__builtin_expect(field_is_zero(), 0))
+         throw pm::GMP::ZeroDivide();
+      const juliainterface::operation_timer timer(dispatch, juliainterface::operation::div);
+      if (dispatch->native) {
+         QuadraticExtension<Rational> quot = *a.elem.native / *elem.native;
+         native_for_update() = std::move(quot);
+      } else {
+         replace_julia_elem(dispatch->div(a.elem.julia_elem, elem.julia_elem));
+      }
+      demote_if_rational();
+      return *this;
+   }
+   OscarNumber quot(a);
+   quot /= *this;
+   return *this = std::move(quot);
+}
 
+void OscarNumber::field_negate() {
+   if (dispatch->native)
+      native_for_update().negate();
+   else if (!field_is_zero())
+      replace_julia_elem(julia_elem_unique() && dispatch->negate_inplace
+                         ? dispatch->negate_inplace(elem.julia_elem)
+                         : dispatch->negate(elem.julia_elem));
 }
 
 OscarNumber& OscarNumber::negate() {
-   impl->negate();
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::negate);
+   if (!dispatch) {
+      rational.negate();
+   } else if (__builtin_expect(elem.infinity == 0, 1)) {
+      field_negate();
+   } else {
+      elem.infinity = -elem.infinity;
+   }
    return *this;
 }
 
+namespace {
+
+QuadraticExtension<Rational> native_pow(const QuadraticExtension<Rational>& a, Int k) {
+   QuadraticExtension<Rational> base = k < 0 ? QuadraticExtension<Rational>(1) / a : a;
+   QuadraticExtension<Rational> result(1);
+   for (unsigned long e = k < 0 ? -static_cast<unsigned long>(k) : k; e; e >>= 1) {
+      if (e & 1) result *= base;
+      if (e > 1) base *= QuadraticExtension<Rational>(base);
+   }
+   return result;
+}
+
+}
+
 OscarNumber pow(const OscarNumber& a, Int k) {
-   return OscarNumber(a.impl->pow(k));
+   const juliainterface::operation_timer timer(a.dispatch, juliainterface::operation::pow);
+   if (!a.dispatch)
+      return OscarNumber(Rational::pow(a.rational, k));
+   if (__builtin_expect(a.elem.infinity == 0, 1)) {
+      // julia might return the argument itself, e.g. for k == 1
+      OscarNumber result = a.dispatch->native
+                           ? OscarNumber(native_pow(*a.elem.native, k), *a.dispatch)
+                           : OscarNumber(a.dispatch->pow(a.elem.julia_elem, k), *a.dispatch, false);
+      result.demote_if_rational();
+      return result;
+   } else if (k > 0)
+      return OscarNumber(Rational::infinity(k%2 == 0 ? 1 : a.elem.infinity));
+   else if (k == 0)
+      throw pm::GMP::NaN();
+   else
+      return OscarNumber(Rational(0));
+}
+
+void OscarNumber::field_add_mul(const OscarNumber& a, const OscarNumber& b) {
+   if (!dispatch->addmul) {
+      OscarNumber t(a);
+      t.field_mul(b);
+      field_add(t);
+      return;
+   }
+   juliainterface::ensure_julia_thread();
+   jl_value_t* av = a.elem.julia_elem;
+   jl_value_t* bv = b.elem.julia_elem;
+   JL_GC_PUSH2(&av, &bv);
+   jl_value_t* res = julia_elem_unique() && dispatch->addmul_inplace
+                     ? dispatch->addmul_inplace(elem.julia_elem, av, bv)
+                     : dispatch->addmul(elem.julia_elem, av, bv);
+   JL_GC_POP();
+   replace_julia_elem(res);
+}
+
+OscarNumber& OscarNumber::add_mul(const OscarNumber& a, const OscarNumber& b) {
+   const oscar_number_dispatch* d = common_field({this, &a, &b});
+   const juliainterface::operation_timer timer(d, juliainterface::operation::add_mul);
+   if (!d) {
+      rational += a.rational * b.rational;
+      return *this;
+   }
+   if (!d->addmul || this->is_inf() || a.is_inf() || b.is_inf())
+      return *this += a * b;
+   if (!dispatch)
+      upgrade_to(*d);
+   const auto av = a.julia_value_in(*d);
+   const auto bv = b.julia_value_in(*d);
+   jl_value_t* res = julia_elem_unique() && d->addmul_inplace
+                     ? d->addmul_inplace(elem.julia_elem, av, bv)
+                     : d->addmul(elem.julia_elem, av, bv);
+   replace_julia_elem(res);
+   demote_if_rational();
+   return *this;
+}
+
+OscarNumber& OscarNumber::sub_mul(const OscarNumber& a, const OscarNumber& b) {
+   const oscar_number_dispatch* d = common_field({this, &a, &b});
+   const juliainterface::operation_timer timer(d, juliainterface::operation::sub_mul);
+   if (!d) {
+      rational -= a.rational * b.rational;
+      return *this;
+   }
+   if (!d->submul || this->is_inf() || a.is_inf() || b.is_inf())
+      return *this -= a * b;
+   if (!dispatch)
+      upgrade_to(*d);
+   const auto av = a.julia_value_in(*d);
+   const auto bv = b.julia_value_in(*d);
+   jl_value_t* res = julia_elem_unique() && d->submul_inplace
+                     ? d->submul_inplace(elem.julia_elem, av, bv)
+                     : d->submul(elem.julia_elem, av, bv);
+   replace_julia_elem(res);
+   demote_if_rational();
+   return *this;
+}
+
+OscarNumber fma(const OscarNumber& a, const OscarNumber& b, const OscarNumber& c) {
+   const oscar_number_dispatch* d = OscarNumber::common_field({&a, &b, &c});
+   const juliainterface::operation_timer timer(d, juliainterface::operation::fma);
+   if (!d)
+      return OscarNumber(a.rational * b.rational + c.rational);
+   if (!d->addmul || a.is_inf() || b.is_inf() || c.is_inf())
+      return a * b + c;
+   const auto av = a.julia_value_in(*d);
+   const auto bv = b.julia_value_in(*d);
+   const auto cv = c.julia_value_in(*d);
+   jl_value_t* res = d->addmul(cv, av, bv);
+   OscarNumber result(res, *d);
+   result.demote_if_rational();
+   return result;
+}
+
+OscarNumber cross_diff(const OscarNumber& a, const OscarNumber& b, const OscarNumber& c, const OscarNumber& d) {
+   const oscar_number_dispatch* f = OscarNumber::common_field({&a, &b, &c, &d});
+   const juliainterface::operation_timer timer(f, juliainterface::operation::cross_diff);
+   if (!f)
+      return OscarNumber(a.rational * b.rational - c.rational * d.rational);
+   if (!f->cross_diff || a.is_inf() || b.is_inf() || c.is_inf() || d.is_inf())
+      return a * b - c * d;
+   const auto av = a.julia_value_in(*f);
+   const auto bv = b.julia_value_in(*f);
+   const auto cv = c.julia_value_in(*f);
+   const auto dv = d.julia_value_in(*f);
+   jl_value_t* res = f->cross_diff(av, bv, cv, dv);
+   OscarNumber result(res, *f);
+   result.demote_if_rational();
+   return result;
+}
+
+OscarNumber cross_diff_div(const OscarNumber& a, const OscarNumber& b, const OscarNumber& c, const OscarNumber& d,
+                           const OscarNumber& p, const OscarNumber& inv_p) {
+   const oscar_number_dispatch* f = OscarNumber::common_field({&a, &b, &c, &d, &p});
+   const juliainterface::operation_timer timer(f, juliainterface::operation::cross_diff_div);
+   if (!f)
+      return OscarNumber((a.rational * b.rational - c.rational * d.rational) / p.rational);
+   if (!f->cross_diff_div || a.is_inf() || b.is_inf() || c.is_inf() || d.is_inf() || p.is_inf()) {
+      OscarNumber result = cross_diff(a, b, c, d);
+      result *= inv_p;
+      return result;
+   }
+   const auto av = a.julia_value_in(*f);
+   const auto bv = b.julia_value_in(*f);
+   const auto cv = c.julia_value_in(*f);
+   const auto dv = d.julia_value_in(*f);
+   const auto pv = p.julia_value_in(*f);
+   jl_value_t* res = f->cross_diff_div(av, bv, cv, dv, pv);
+   OscarNumber result(res, *f);
+   result.demote_if_rational();
+   return result;
+}
+
+namespace {
+
+// field elements in a pair of a batched operation are collected for one julia call,
+// pairs with a rational zero are skipped and the remaining ones use the scalar path
+inline bool is_rational_zero(const OscarNumber& x) {
+   return x.uses_rational() && x.is_zero();
+}
+
+// elements given by a table of their addresses, indexed like a plain array
+struct indirect_entries {
+   const OscarNumber* const* p;
+   const OscarNumber& operator[] (Int i) const { return *p[i]; }
+};
+
+}
+
+template <typename Entries>
+const oscar_number_dispatch* OscarNumber::common_field(const oscar_number_dispatch* d, Entries x, Int n) {
+   for (Int i = 0; i < n; ++i) {
+      if (x[i].dispatch) {
+         if (d && d != x[i].dispatch)
+            throw std::runtime_error("oscar_number_wrap: different julia fields!");
+         d = x[i].dispatch;
+      }
+   }
+   return d;
+}
+
+OscarNumber OscarNumber::dot(const OscarNumber* a, const OscarNumber* b, Int n) {
+   return dot_of(a, b, n);
+}
+
+OscarNumber OscarNumber::dot(const OscarNumber* const* a, const OscarNumber* const* b, Int n) {
+   return dot_of(indirect_entries{a}, indirect_entries{b}, n);
+}
+
+template <typename Entries>
+OscarNumber OscarNumber::dot_of(Entries a, Entries b, Int n) {
+   const oscar_number_dispatch* d = common_field(common_field(nullptr, a, n), b, n);
+   const juliainterface::operation_timer timer(d, juliainterface::operation::dot);
+   bool finite = true;
+   for (Int i = 0; i < n && finite; ++i)
+      finite = !a[i].is_inf() && !b[i].is_inf();
+   OscarNumber result;
+   if (!d || !d->dot || !finite) {
+      for (Int i = 0; i < n; ++i)
+         result.add_mul(a[i], b[i]);
+      return result;
+   }
+   std::vector<jl_value_t*> av, bv;
+   std::vector<Int> mixed;
+   Rational rational_sum(0);
+   av.reserve(n);
+   bv.reserve(n);
+   for (Int i = 0; i < n; ++i) {
+      if (a[i].dispatch && b[i].dispatch) {
+         av.push_back(a[i].elem.julia_elem);
+         bv.push_back(b[i].elem.julia_elem);
+      } else if (!a[i].dispatch && !b[i].dispatch) {
+         rational_sum += a[i].rational * b[i].rational;
+      } else if (!is_rational_zero(a[i]) && !is_rational_zero(b[i])) {
+         mixed.push_back(i);
+      }
+   }
+   if (!av.empty())
+      result = OscarNumber(d->dot(av.data(), bv.data(), av.size()), *d);
+   for (Int i : mixed)
+      result.add_mul(a[i], b[i]);
+   if (!pm::is_zero(rational_sum))
+      result += rational_sum;
+   result.demote_if_rational();
+   return result;
+}
+
+Int OscarNumber::sign_of_dot(const OscarNumber* a, const OscarNumber* b, Int n) {
+   const oscar_number_dispatch* d = common_field(common_field(nullptr, a, n), b, n);
+   const juliainterface::operation_timer timer(d, juliainterface::operation::sign_of_dot);
+   bool batched = true;
+   for (Int i = 0; i < n && batched; ++i) {
+      // everything else needs the full dot product
+      batched = a[i].dispatch && b[i].dispatch
+                ? !a[i].elem.infinity && !b[i].elem.infinity
+                : is_rational_zero(a[i]) || is_rational_zero(b[i]);
+   }
+   if (!d || !d->sign_dot || !batched)
+      return dot(a, b, n).sign();
+   std::vector<jl_value_t*> av, bv;
+   av.reserve(n);
+   bv.reserve(n);
+   for (Int i = 0; i < n; ++i) {
+      if (a[i].dispatch && b[i].dispatch) {
+         av.push_back(a[i].elem.julia_elem);
+         bv.push_back(b[i].elem.julia_elem);
+      }
+   }
+   if (av.empty())
+      return 0;
+   return d->sign_dot(av.data(), bv.data(), av.size());
+}
+
+void OscarNumber::add_scaled(OscarNumber* y, const OscarNumber& c, const OscarNumber* x, Int n) {
+   if (c.is_zero()) {
+      // 0*inf is left to add_mul, which rejects it like the scalar product
+      bool finite = true;
+      for (Int i = 0; i < n && finite; ++i)
+         finite = !x[i].is_inf();
+      if (finite)
+         return;
+   }
+   const oscar_number_dispatch* d = common_field(common_field(c.dispatch, y, n), x, n);
+   const juliainterface::operation_timer timer(d, juliainterface::operation::add_scaled);
+   bool finite = !c.is_inf();
+   for (Int i = 0; i < n && finite; ++i)
+      finite = !y[i].is_inf() && !x[i].is_inf();
+   if (!d || !d->axpy || !finite) {
+      for (Int i = 0; i < n; ++i)
+         y[i].add_mul(c, x[i]);
+      return;
+   }
+   std::vector<jl_value_t*> yv, xv;
+   std::vector<Int> batched, scalar;
+   yv.reserve(n);
+   xv.reserve(n);
+   for (Int i = 0; i < n; ++i) {
+      if (y[i].dispatch && x[i].dispatch) {
+         batched.push_back(i);
+         yv.push_back(y[i].elem.julia_elem);
+         xv.push_back(x[i].elem.julia_elem);
+      } else if (!is_rational_zero(x[i])) {
+         scalar.push_back(i);
+      }
+   }
+   if (!batched.empty()) {
+      const auto cv = c.julia_value_in(*d);
+      juliainterface::ensure_julia_thread();
+      jl_value_t* res = nullptr;
+      JL_GC_PUSH1(&res);
+      res = d->axpy(yv.data(), cv, xv.data(), batched.size());
+      for (size_t k = 0; k < batched.size(); ++k)
+         y[batched[k]].replace_julia_elem(jl_array_ptr_ref(res, k));
+      JL_GC_POP();
+   }
+   for (Int i : scalar)
+      y[i].add_mul(c, x[i]);
+}
+
+Int OscarNumber::field_cmp(const OscarNumber& b) const {
+   if (dispatch->native)
+      return elem.native->compare(*b.elem.native);
+   if (elem.julia_elem == b.elem.julia_elem)
+      return 0;
+   juliainterface::interval ea, eb;
+   if (juliainterface::enclosure_of(*dispatch, elem.slot, elem.julia_elem, ea) &&
+       juliainterface::enclosure_of(*dispatch, b.elem.slot, b.elem.julia_elem, eb)) {
+      const Int res = juliainterface::cmp_of(ea, eb);
+      if (res != 2) {
+         ++dispatch->filter.decided;
+         return res;
+      }
+      ++dispatch->filter.undecided;
+   }
+   return dispatch->cmp(elem.julia_elem, b.elem.julia_elem);
 }
 
 Int OscarNumber::cmp(const OscarNumber& b) const {
-   if (this->uses_rational() == b.uses_rational())
-      return impl->cmp(b.impl.get());
-   if (b.uses_rational())
-      return -b.cmp(*this);
-   // need a copy for the upgrade
-   OscarNumber on(*this);
-   (void) juliainterface::maybe_upgrade(on.impl, b.impl);
-   return on.impl->cmp(b.impl.get());
+   if (!b.dispatch)
+      return this->cmp(b.rational);
+   if (!dispatch)
+      return -b.cmp(rational);
+   if (dispatch != b.dispatch)
+      throw std::runtime_error("oscar_number_wrap: different julia fields!");
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::cmp);
+   const Int a_inf = elem.infinity;
+   const Int b_inf = b.elem.infinity;
+   if (__builtin_expect(a_inf == 0 && b_inf == 0, 1))
+      return field_cmp(b);
+   Int res = a_inf - b_inf;
+   return res < 0 ? -1 : (res > 0 ? 1 : 0);
 }
 
 Int OscarNumber::cmp(const Rational& r) const {
-   return this->cmp(OscarNumber(r));
+   if (!dispatch)
+      return rational.compare(r);
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::cmp_rational);
+   const Int a_inf = elem.infinity;
+   const Int b_inf = isinf(r);
+   if (__builtin_expect(a_inf == 0 && b_inf == 0, 1)) {
+      if (dispatch->native)
+         return elem.native->compare(r);
+      if (pm::is_zero(r))
+         return this->sign();
+      juliainterface::interval ea;
+      if (juliainterface::enclosure_of(*dispatch, elem.slot, elem.julia_elem, ea)) {
+         const Int res = juliainterface::cmp_of(ea, juliainterface::enclosure_of(r));
+         if (res != 2) {
+            ++dispatch->filter.decided;
+            return res;
+         }
+         ++dispatch->filter.undecided;
+      }
+      if (dispatch->cmp_rational)
+         return dispatch->cmp_rational(elem.julia_elem, numerator(r).get_rep(), denominator(r).get_rep());
+      jl_value_t* bv = juliainterface::julia_from_rational(*dispatch, r);
+      JL_GC_PUSH1(&bv);
+      Int res = dispatch->cmp(elem.julia_elem, bv);
+      JL_GC_POP();
+      return res;
+   }
+   Int res = a_inf - b_inf;
+   return res < 0 ? -1 : (res > 0 ? 1 : 0);
+}
+
+bool OscarNumber::field_is_zero() const {
+   if (dispatch->native)
+      return pm::is_zero(*elem.native);
+   juliainterface::interval e;
+   if (juliainterface::enclosure_of(*dispatch, elem.slot, elem.julia_elem, e)) {
+      const Int s = juliainterface::sign_of(e);
+      if (s != 2) {
+         ++dispatch->filter.decided;
+         return s == 0;
+      }
+      ++dispatch->filter.undecided;
+   }
+   return dispatch->is_zero(elem.julia_elem);
 }
 
 bool OscarNumber::is_zero() const {
-   return impl->is_zero();
+   if (!dispatch)
+      return pm::is_zero(rational);
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::is_zero);
+   if (__builtin_expect(elem.infinity == 0, 1))
+      return field_is_zero();
+   return false;
 }
 bool OscarNumber::is_one() const {
-   return impl->is_one();
+   if (!dispatch)
+      return pm::is_one(rational);
+   if (__builtin_expect(elem.infinity == 0, 1))
+      return dispatch->native ? pm::is_one(*elem.native) : dispatch->is_one(elem.julia_elem);
+   return false;
 }
 
 Int OscarNumber::is_inf() const {
-   return impl->is_inf();
+   if (!dispatch)
+      return isinf(rational);
+   return elem.infinity;
 }
 
 OscarNumber OscarNumber::infinity(Int sign) {
    return OscarNumber(Rational::infinity(sign));
 }
 
+Int OscarNumber::field_sign() const {
+   if (dispatch->native)
+      return pm::sign(*elem.native);
+   juliainterface::interval e;
+   if (juliainterface::enclosure_of(*dispatch, elem.slot, elem.julia_elem, e)) {
+      const Int s = juliainterface::sign_of(e);
+      if (s != 2) {
+         ++dispatch->filter.decided;
+         return s;
+      }
+      ++dispatch->filter.undecided;
+   }
+   return dispatch->sign(elem.julia_elem);
+}
+
 Int OscarNumber::sign() const {
-   return impl->sign();
+   if (!dispatch)
+      return pm::sign(rational);
+   const juliainterface::operation_timer timer(dispatch, juliainterface::operation::sign);
+   if (__builtin_expect(elem.infinity == 0, 1))
+      return field_sign();
+   return elem.infinity;
 }
 
 OscarNumber abs(const OscarNumber& on) {
-   return OscarNumber(on.impl->abs_value());
+   if (!on.dispatch)
+      return OscarNumber(abs(on.rational));
+   if (on.dispatch->native && on.elem.infinity == 0)
+      return OscarNumber(pm::abs(*on.elem.native), *on.dispatch);
+   if (__builtin_expect(on.elem.infinity == 0, 1))
+      return OscarNumber(on.dispatch->abs(on.elem.julia_elem), *on.dispatch, false);
+   return OscarNumber(Rational::infinity(1));
+}
+
+// equal values have equal hashes in both representations: rational values are
+// hashed as Rational, only irrational field elements use the julia hash;
+// the hash of a field element is cached in its slot
+namespace {
+
+size_t hash_infinity(Int sign) {
+   return sign > 0 ? ~size_t(0) : ~size_t(1);
+}
+
+size_t hash_rational(const Rational& r) {
+   static auto hashfun = pm::hash_func<Rational>();
+   return isfinite(r) ? hashfun(r) : hash_infinity(isinf(r));
+}
+
 }
 
 size_t OscarNumber::hash() const {
-   return impl->hash();
+   if (!dispatch)
+      return hash_rational(rational);
+   if (elem.infinity)
+      return hash_infinity(elem.infinity);
+   if (dispatch->native)
+      return pm::is_zero(elem.native->b()) ? hash_rational(elem.native->a())
+                                           : pm::hash_func<QuadraticExtension<Rational>>()(*elem.native);
+   size_t h;
+   if (dispatch->roots->hash(elem.slot, h))
+      return h;
+   if (mpq_ptr q = dispatch->to_rational(elem.julia_elem)) {
+      Rational r;
+      r.copy_from(q);
+      h = hash_rational(r);
+   } else {
+      h = dispatch->hash(elem.julia_elem);
+   }
+   dispatch->roots->set_hash(elem.slot, h);
+   return h;
 }
 
 OscarNumber::operator Rational() const {
-   return Rational(impl->as_rational());
+   if (!dispatch)
+      return rational;
+   if (__builtin_expect(elem.infinity == 0, 1)) {
+      if (dispatch->native) {
+         if (!pm::is_zero(elem.native->b()))
+            throw std::runtime_error("OscarNumber: could not convert field element to rational");
+         return elem.native->a();
+      }
+      Rational r;
+      mpq_ptr q = dispatch->to_rational(elem.julia_elem);
+      if (q == nullptr) {
+         throw std::runtime_error("OscarNumber: could not convert field element to rational");
+      }
+      r.copy_from(q);
+      return r;
+   } else {
+      return Rational::infinity(elem.infinity);
+   }
 }
 
 OscarNumber::operator double() const {
-   return impl->as_float();
+   if (!dispatch)
+      return static_cast<double>(rational);
+   if (__builtin_expect(elem.infinity == 0, 1))
+      return dispatch->native ? double(*elem.native) : dispatch->to_float(elem.julia_elem);
+   return std::numeric_limits<double>::infinity() * static_cast<double>(elem.infinity);
+}
+
+// binary encoding of single elements, see oscarnumber_binary.h for the container format
+namespace {
+
+enum class serialized_tag : char { rational = 0, plus_infinity = 1, minus_infinity = 2, field = 3 };
+
+void put_mpz(std::string& out, mpz_srcptr z) {
+   const int64_t size = z->_mp_size;
+   out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+   out.append(reinterpret_cast<const char*>(z->_mp_d), mpz_size(z) * sizeof(mp_limb_t));
+}
+
+void put_mpq(std::string& out, mpq_srcptr q) {
+   put_mpz(out, mpq_numref(q));
+   put_mpz(out, mpq_denref(q));
+}
+
+void check_available(const char* pos, const char* end, size_t n) {
+   if (size_t(end - pos) < n)
+      throw std::runtime_error("OscarNumber: truncated binary data");
+}
+
+void get_mpz(const char*& pos, const char* end, mpz_ptr z) {
+   int64_t size;
+   check_available(pos, end, sizeof(size));
+   std::memcpy(&size, pos, sizeof(size));
+   pos += sizeof(size);
+   // the limb count is bounded by the remaining data before anything is allocated,
+   // this also rules out the negation of INT64_MIN and an overflow of the byte count
+   const uint64_t limbs = size < 0 ? -uint64_t(size) : uint64_t(size);
+   if (limbs > uint64_t(end - pos) / sizeof(mp_limb_t))
+      throw std::runtime_error("OscarNumber: truncated binary data");
+   size_t n = limbs;
+   mp_limb_t* d = mpz_limbs_write(z, n ? n : 1);
+   std::memcpy(d, pos, n * sizeof(mp_limb_t));
+   pos += n * sizeof(mp_limb_t);
+   // leading zero limbs would break the invariants of GMP
+   while (n > 0 && d[n-1] == 0)
+      --n;
+   mpz_limbs_finish(z, size < 0 ? -mp_size_t(n) : mp_size_t(n));
+}
+
+void get_mpq(const char*& pos, const char* end, mpq_ptr q) {
+   get_mpz(pos, end, mpq_numref(q));
+   get_mpz(pos, end, mpq_denref(q));
+   if (mpz_sgn(mpq_denref(q)) <= 0)
+      throw std::runtime_error("OscarNumber: invalid denominator in binary data");
+   // the writer stores canonical fractions, but nothing else relies on the file
+   mpq_canonicalize(q);
+}
+
+}
+
+void OscarNumber::append_serialized(std::string& out) const {
+   const Int inf = is_inf();
+   if (inf) {
+      out.push_back(char(inf > 0 ? serialized_tag::plus_infinity : serialized_tag::minus_infinity));
+   } else if (!dispatch) {
+      out.push_back(char(serialized_tag::rational));
+      put_mpq(out, rational.get_rep());
+   } else if (dispatch->native) {
+      out.push_back(char(serialized_tag::field));
+      const uint64_t count = 2;
+      out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+      put_mpq(out, elem.native->a().get_rep());
+      put_mpq(out, elem.native->b().get_rep());
+   } else {
+      if (!dispatch->coeffs)
+         throw std::runtime_error("OscarNumber: field does not support binary serialization");
+      juliainterface::mpq_buffer c;
+      c.resize(8);
+      long n = dispatch->coeffs(elem.julia_elem, c.data(), 8);
+      if (n > 8) {
+         c.resize(n);
+         dispatch->coeffs(elem.julia_elem, c.data(), n);
+      }
+      out.push_back(char(serialized_tag::field));
+      const uint64_t count = n;
+      out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+      for (long i = 0; i < n; ++i)
+         put_mpq(out, c.data()[i]);
+   }
+}
+
+std::string OscarNumber::to_serialized() const {
+   std::string out;
+   append_serialized(out);
+   return out;
+}
+
+OscarNumber OscarNumber::from_serialized(const char*& pos, const char* end, long index) {
+   check_available(pos, end, 1);
+   const serialized_tag tag = serialized_tag(*pos++);
+   switch (tag) {
+   case serialized_tag::plus_infinity:
+      return infinity(1);
+   case serialized_tag::minus_infinity:
+      return infinity(-1);
+   case serialized_tag::rational: {
+      juliainterface::mpq_buffer q;
+      q.resize(1);
+      get_mpq(pos, end, q.data()[0]);
+      Rational r;
+      r.copy_from(q.data()[0]);
+      return OscarNumber(r);
+   }
+   case serialized_tag::field: {
+      const oscar_number_dispatch& d = juliainterface::get_dispatch(index);
+      if (!d.from_coeffs)
+         throw std::runtime_error("OscarNumber: field does not support binary serialization");
+      uint64_t n;
+      check_available(pos, end, sizeof(n));
+      std::memcpy(&n, pos, sizeof(n));
+      pos += sizeof(n);
+      // every coefficient takes at least the two limb counts
+      if (n > uint64_t(end - pos) / (2 * sizeof(int64_t)))
+         throw std::runtime_error("OscarNumber: truncated binary data");
+      juliainterface::mpq_buffer c;
+      c.resize(n);
+      for (uint64_t i = 0; i < n; ++i)
+         get_mpq(pos, end, c.data()[i]);
+      if (d.native) {
+         if (n > 2)
+            throw std::runtime_error("OscarNumber: element of a quadratic field with more than two coefficients");
+         Rational a(0), b(0);
+         if (n > 0) a.copy_from(c.data()[0]);
+         if (n > 1) b.copy_from(c.data()[1]);
+         return OscarNumber(QuadraticExtension<Rational>(a, b, d.quadratic_root), d);
+      }
+      return OscarNumber(d.from_coeffs(d.index, c.const_data(), n), d);
+   }
+   default:
+      throw std::runtime_error("OscarNumber: invalid tag in binary data");
+   }
+}
+
+const oscar_number_dispatch& OscarNumber::field_dispatch(long index) {
+   return juliainterface::get_dispatch(index);
+}
+
+OscarNumber OscarNumber::embed(const Rational& x, const oscar_number_dispatch& d) {
+   if (__builtin_expect(!isfinite(x), 0))
+      throw std::runtime_error("OscarNumber: infinite value in a field-typed element");
+   OscarNumber result(x);
+   result.upgrade_to(d);
+   return result;
+}
+
+long OscarNumber::field_index() const {
+   return dispatch ? dispatch->index : 0;
+}
+
+std::string OscarNumber::field_descriptor(long index) {
+   const oscar_number_dispatch& d = juliainterface::get_dispatch(index);
+   if (!d.descriptor)
+      return std::string();
+   return std::string(d.descriptor(index));
 }
 
 bool OscarNumber::uses_rational() const {
-   return impl->uses_rational();
+   return dispatch == nullptr;
 }
 
 void* OscarNumber::unsafe_get() const {
-   return reinterpret_cast<void*>(impl->for_julia());
+   if (!dispatch)
+      // we should probably never end up here
+      throw std::runtime_error("oscar_number_rational: not implemented");
+   jl_value_t* v = dispatch->native ? materialize() : elem.julia_elem;
+   // the caller may keep references to the element
+   dispatch->roots->expose(elem.slot);
+   return reinterpret_cast<void*>(v);
+}
+
+jl_value_t* OscarNumber::new_container(long index, Int n, root_slot& slot, jl_value_t* from) {
+   const oscar_number_dispatch& d = juliainterface::get_dispatch(index);
+   // nothing is allocated before the array is pinned
+   juliainterface::ensure_julia_thread();
+   jl_value_t* a = reinterpret_cast<jl_value_t*>(jl_alloc_vec_any(n));
+   slot = d.roots->pin(a, true);
+   // the elements are exposed already, copying the references is enough
+   if (from)
+      for (Int i = 0; i < n; ++i)
+         jl_array_ptr_set(a, i, jl_array_ptr_ref(from, i));
+   return a;
+}
+
+void OscarNumber::release_container(long index, root_slot slot) {
+   if (!in_cleanup)
+      juliainterface::get_dispatch(index).roots->release(slot);
+}
+
+void OscarNumber::container_store(jl_value_t* c, Int i, const OscarNumber* x) {
+   // the store has a write barrier, the current thread must be known to julia
+   juliainterface::ensure_julia_thread();
+   jl_array_ptr_set(c, i, x ? x->unsafe_get() : nullptr);
+}
+
+void OscarNumber::from_julia(void* const* elems, Int n, long index, OscarNumber* out) {
+   const oscar_number_dispatch& d = juliainterface::get_dispatch(index);
+   if (d.native) {
+      // the values are converted anyway, nothing to share
+      for (Int i = 0; i < n; ++i)
+         out[i] = OscarNumber(elems[i], index);
+      return;
+   }
+   std::vector<root_slot> slots(n);
+   d.roots->pin_many(reinterpret_cast<jl_value_t* const*>(elems), n, true, slots.data());
+   for (Int i = 0; i < n; ++i) {
+      out[i].release();
+      out[i].dispatch = &d;
+      out[i].elem.julia_elem = reinterpret_cast<jl_value_t*>(elems[i]);
+      out[i].elem.slot = slots[i];
+      out[i].elem.infinity = 0;
+   }
+}
+
+void* OscarNumber::to_julia(const OscarNumber* const* x, Int n, long index) {
+   const oscar_number_dispatch& d = juliainterface::get_dispatch(index);
+   // no exceptions may pass the gc frame below
+   for (Int i = 0; i < n; ++i) {
+      if (x[i]->dispatch && x[i]->dispatch != &d)
+         throw std::runtime_error("oscar_number_wrap: different julia fields!");
+      if (x[i]->is_inf())
+         throw std::runtime_error("OscarNumber: infinite values can't be passed to julia");
+   }
+   // the conversions and materializations may throw as well, so they are done before the
+   // gc frame; the converted rationals are held by the arena until the array refers to them
+   juliainterface::ensure_julia_thread();
+   std::vector<jl_value_t*> values(n);
+   std::vector<root_slot> exposed, converted;
+   exposed.reserve(n);
+   converted.reserve(n);
+   try {
+      for (Int i = 0; i < n; ++i) {
+         const OscarNumber& e = *x[i];
+         if (e.dispatch) {
+            values[i] = d.native ? e.materialize() : e.elem.julia_elem;
+            exposed.push_back(e.elem.slot);
+         } else {
+            values[i] = juliainterface::julia_from_rational(d, e.rational);
+            converted.push_back(d.roots->pin(values[i]));
+         }
+      }
+   }
+   catch (...) {
+      for (root_slot s : converted)
+         d.roots->release(s);
+      throw;
+   }
+   jl_array_t* a = jl_alloc_vec_any(n);
+   JL_GC_PUSH1(&a);
+   for (Int i = 0; i < n; ++i)
+      jl_array_ptr_set(a, i, values[i]);
+   // julia may keep references to the elements
+   d.roots->expose_many(exposed.data(), exposed.size());
+   for (root_slot s : converted)
+      d.roots->release(s);
+   JL_GC_POP();
+   return reinterpret_cast<void*>(a);
 }
 
 std::string OscarNumber::to_string() const {
-   return impl->to_string();
+   std::ostringstream str;
+   str << "(";
+   if (!dispatch) {
+      if (__builtin_expect(isfinite(rational), 1)) {
+         str << numerator(rational);
+         if (!rational.is_integral()) {
+            str << "//";
+            str << denominator(rational);
+         }
+      } else {
+         str << rational;
+      }
+   } else if (__builtin_expect(elem.infinity == 0, 1)) {
+      // native values are printed by julia as well, for the same format
+      char* cstr = dispatch->to_string(dispatch->native ? materialize() : elem.julia_elem);
+      str << cstr;
+   } else {
+      str << (elem.infinity > 0 ? "inf" : "-inf");
+   }
+   str << ")";
+   return str.str();
+}
+
+OscarNumberScope::OscarNumberScope() {
+   juliainterface::enter_rooting_scope();
+}
+
+OscarNumberScope::~OscarNumberScope() {
+   juliainterface::leave_rooting_scope();
+}
+
+OscarNumberCacheStats OscarNumber::constant_cache_stats(long index) {
+   return juliainterface::get_dispatch(index).constants.statistics();
+}
+
+OscarNumberFilterStats OscarNumber::filter_stats(long index) {
+   const juliainterface::filter_counters& c = juliainterface::get_dispatch(index).filter;
+   OscarNumberFilterStats stats;
+   stats.decided = c.decided;
+   stats.undecided = c.undecided;
+   stats.enclosures = c.enclosures;
+   return stats;
+}
+
+namespace {
+
+template <typename F>
+void for_each_callback(const oscar_number_dispatch& d, F f) {
+   f("init", d.init.counter);
+   f("init_from_mpz", d.init_from_mpz.counter);
+   f("copy", d.copy.counter);
+   f("gc_protect", d.gc_protect.counter);
+   f("gc_free", d.gc_free.counter);
+   f("add", d.add.counter);
+   f("sub", d.sub.counter);
+   f("mul", d.mul.counter);
+   f("div", d.div.counter);
+   f("pow", d.pow.counter);
+   f("negate", d.negate.counter);
+   f("cmp", d.cmp.counter);
+   f("to_string", d.to_string.counter);
+   f("from_string", d.from_string.counter);
+   f("is_zero", d.is_zero.counter);
+   f("is_one", d.is_one.counter);
+   f("is_inf", d.is_inf.counter);
+   f("sign", d.sign.counter);
+   f("abs", d.abs.counter);
+   f("hash", d.hash.counter);
+   f("to_rational", d.to_rational.counter);
+   f("to_float", d.to_float.counter);
+   f("addmul", d.addmul.counter);
+   f("submul", d.submul.counter);
+   f("cross_diff", d.cross_diff.counter);
+   f("add_inplace", d.add_inplace.counter);
+   f("sub_inplace", d.sub_inplace.counter);
+   f("mul_inplace", d.mul_inplace.counter);
+   f("div_inplace", d.div_inplace.counter);
+   f("negate_inplace", d.negate_inplace.counter);
+   f("addmul_inplace", d.addmul_inplace.counter);
+   f("submul_inplace", d.submul_inplace.counter);
+   f("dot", d.dot.counter);
+   f("axpy", d.axpy.counter);
+   f("sign_dot", d.sign_dot.counter);
+   f("add_rational", d.add_rational.counter);
+   f("sub_rational", d.sub_rational.counter);
+   f("mul_rational", d.mul_rational.counter);
+   f("div_rational", d.div_rational.counter);
+   f("cmp_rational", d.cmp_rational.counter);
+   f("enclose", d.enclose.counter);
+   f("coeffs", d.coeffs.counter);
+   f("from_coeffs", d.from_coeffs.counter);
+   f("descriptor", d.descriptor.counter);
+   f("is_rational", d.is_rational.counter);
+   f("cross_diff_div", d.cross_diff_div.counter);
+}
+
+}
+
+void OscarNumber::set_instrumentation(bool enable) {
+   juliainterface::instrumentation_enabled = enable;
+}
+
+bool OscarNumber::instrumentation() {
+   return juliainterface::instrumentation_enabled;
+}
+
+std::vector<OscarNumberCallStats> OscarNumber::call_stats(long index) {
+   const oscar_number_dispatch& d = juliainterface::get_dispatch(index);
+   std::vector<OscarNumberCallStats> stats;
+   for_each_callback(d, [&stats](const char* name, const juliainterface::call_counter& c) {
+      stats.push_back(OscarNumberCallStats{ name, c.calls, c.ns });
+   });
+   stats.push_back(OscarNumberCallStats{ "upgrade", d.upgrades, 0 });
+   stats.push_back(OscarNumberCallStats{ "demotion", d.demotions, 0 });
+   stats.push_back(OscarNumberCallStats{ "shared_write", d.roots->shared_writes, 0 });
+   for (size_t op = 0; op < size_t(juliainterface::operation::count); ++op)
+      stats.push_back(OscarNumberCallStats{ std::string("OscarNumber::") + juliainterface::operation_names[op],
+                                            d.operations[op].calls, d.operations[op].ns });
+   return stats;
+}
+
+void OscarNumber::reset_call_stats(long index) {
+   const oscar_number_dispatch& d = juliainterface::get_dispatch(index);
+   for_each_callback(d, [](const char*, juliainterface::call_counter& c) { c.reset(); });
+   d.upgrades = 0;
+   d.demotions = 0;
+   d.roots->shared_writes = 0;
+   for (juliainterface::call_counter& c : d.operations)
+      c.reset();
+}
+
+void OscarNumber::attach_thread() {
+   if (jl_get_pgcstack())
+      return;
+#if JULIA_VERSION_MAJOR > 1 || JULIA_VERSION_MINOR >= 9
+   jl_adopt_thread();
+#else
+   throw std::runtime_error("polymake::OscarNumber: julia >= 1.9 is needed to use OscarNumbers from other threads");
+#endif
+}
+
+namespace {
+
+std::atomic<Int> n_threads{ Int(std::max(1u, std::thread::hardware_concurrency())) };
+
+// set while a thread executes a task of the pool, nested parallel loops run serially
+thread_local bool in_pool_task = false;
+
+// Persistent workers for oscarnumber_parallel_for, julia adopts each of them once.
+// Waiting threads (idle workers and the caller waiting for the workers) are marked
+// gc-safe so that a collection started by a busy worker is not blocked.
+class worker_pool {
+   public:
+      // runs task(0) on the calling thread and task(1) ... task(n-1) on the workers
+      void run(Int n, const std::function<void(Int)>& task) {
+         juliainterface::gc_safe_lock serialize(run_mutex);
+         {
+            juliainterface::gc_safe_lock lock(mutex);
+            while (Int(workers.size()) < n-1) {
+               const Int id = workers.size() + 1;
+               workers.emplace_back([this, id]() { work(id); });
+               // the workers are never joined, they live until the process ends
+               workers.back().detach();
+            }
+            current = &task;
+            participants = n;
+            pending = n-1;
+            errors.assign(n, nullptr);
+            ++generation;
+         }
+         start.notify_all();
+
+         in_pool_task = true;
+         try {
+            task(0);
+         }
+         catch (...) {
+            errors[0] = std::current_exception();
+         }
+         in_pool_task = false;
+
+         {
+            jl_ptls_t ptls = jl_current_task->ptls;
+            int8_t state = jl_gc_safe_enter(ptls);
+            {
+               std::unique_lock<std::mutex> lock(mutex);
+               done.wait(lock, [this]() { return pending == 0; });
+               current = nullptr;
+            }
+            jl_gc_safe_leave(ptls, state);
+         }
+         for (const auto& e : errors)
+            if (e) std::rethrow_exception(e);
+      }
+
+   private:
+      void work(Int id) {
+         OscarNumber::attach_thread();
+         in_pool_task = true;
+         jl_ptls_t ptls = jl_current_task->ptls;
+         int8_t state = jl_gc_safe_enter(ptls);
+         uint64_t seen = 0;
+         std::unique_lock<std::mutex> lock(mutex);
+         for (;;) {
+            start.wait(lock, [&]() { return generation != seen; });
+            seen = generation;
+            if (id >= participants)
+               continue;
+            const std::function<void(Int)>& task = *current;
+            lock.unlock();
+            jl_gc_safe_leave(ptls, state);
+            try {
+               task(id);
+            }
+            catch (...) {
+               errors[id] = std::current_exception();
+            }
+            state = jl_gc_safe_enter(ptls);
+            lock.lock();
+            if (--pending == 0)
+               done.notify_all();
+         }
+      }
+
+      std::mutex run_mutex;
+      std::mutex mutex;
+      std::condition_variable start;
+      std::condition_variable done;
+      std::vector<std::thread> workers;
+      const std::function<void(Int)>* current = nullptr;
+      Int participants = 0;
+      Int pending = 0;
+      uint64_t generation = 0;
+      std::vector<std::exception_ptr> errors;
+};
+
+}
+
+Int oscarnumber_threads() {
+   return n_threads;
+}
+
+void set_oscarnumber_threads(Int n) {
+   n_threads = std::max(Int(1), n);
+}
+
+void oscarnumber_parallel_for(Int n, Int grain, const std::function<void(Int, Int)>& body) {
+   Int threads = std::min(Int(n_threads), grain > 0 ? n / grain : n);
+#if JULIA_VERSION_MAJOR == 1 && JULIA_VERSION_MINOR < 9
+   threads = 1;
+#endif
+   if (threads <= 1 || in_pool_task || !jl_get_pgcstack()) {
+      if (n > 0)
+         body(0, n);
+      return;
+   }
+   // the pool is never destroyed, its workers may still be waiting at exit
+   static worker_pool* pool = new worker_pool;
+   const Int chunk = (n + threads - 1) / threads;
+   pool->run(threads, [&](Int t) {
+      const Int begin = t * chunk;
+      const Int end = std::min(n, begin + chunk);
+      if (begin < end)
+         body(begin, end);
+   });
 }
 
 void oscarnumber_prepare_cleanup() {
@@ -758,66 +2453,110 @@ void oscarnumber_prepare_cleanup() {
 }
 
 void OscarNumber::register_oscar_number(void* disp, long index) {
+   register_oscar_number(disp, index, juliainterface::oscar_number_dispatch_helper_legacy_size);
+}
+
+void OscarNumber::register_oscar_number(void* disp, long index, size_t helper_size) {
    using namespace juliainterface;
-   if (oscar_number_map.find(index) != oscar_number_map.end())
+   if (index <= 0 || size_t(index) >= dispatch_registry::chunk_size * dispatch_registry::max_chunks)
+      throw std::runtime_error("polymake::OscarNumber: invalid field index");
+   if (helper_size < oscar_number_dispatch_helper_legacy_size)
+      throw std::runtime_error("polymake::OscarNumber: dispatch table too small");
+   if (oscar_number_registry.find(index))
       throw std::runtime_error("polymake::OscarNumber: cannot re-register field index");
 
-   oscar_number_dispatch dispatch;
-   dispatch.index = index;
-   oscar_number_dispatch_helper* helper = reinterpret_cast<oscar_number_dispatch_helper*>(disp);
-   dispatch.init          = std::function<jl_value_t*     (long, jl_value_t**, long)>(
-                         reinterpret_cast<jl_value_t* (*) (long, jl_value_t**, long)>(helper->init));
-   dispatch.init_from_mpz = std::function<jl_value_t*     (long, jl_value_t**, const mpz_srcptr, const mpz_srcptr)>(
-                         reinterpret_cast<jl_value_t* (*) (long, jl_value_t**, const mpz_srcptr, const mpz_srcptr)>(helper->init_from_mpz));
-   dispatch.copy          = std::function<jl_value_t*     (jl_value_t*)>(
-                         reinterpret_cast<jl_value_t* (*) (jl_value_t*)>(helper->copy));
-
-   dispatch.gc_protect    = std::function<void     (jl_value_t*)>(
-                         reinterpret_cast<void (*) (jl_value_t*)>(helper->gc_protect));
-   dispatch.gc_free       = std::function<void     (jl_value_t*)>(
-                         reinterpret_cast<void (*) (jl_value_t*)>(helper->gc_free));
-
-   dispatch.add = std::function<jl_value_t*     (jl_value_t*, jl_value_t*)>(
-               reinterpret_cast<jl_value_t* (*) (jl_value_t*, jl_value_t*)>(helper->add));
-   dispatch.sub = std::function<jl_value_t*     (jl_value_t*, jl_value_t*)>(
-               reinterpret_cast<jl_value_t* (*) (jl_value_t*, jl_value_t*)>(helper->sub));
-   dispatch.mul = std::function<jl_value_t*     (jl_value_t*, jl_value_t*)>(
-               reinterpret_cast<jl_value_t* (*) (jl_value_t*, jl_value_t*)>(helper->mul));
-   dispatch.div = std::function<jl_value_t*     (jl_value_t*, jl_value_t*)>(
-               reinterpret_cast<jl_value_t* (*) (jl_value_t*, jl_value_t*)>(helper->div));
-
-   dispatch.pow     = std::function<jl_value_t*     (jl_value_t*, long)>(
-                   reinterpret_cast<jl_value_t* (*) (jl_value_t*, long)>(helper->pow));
-   dispatch.negate  = std::function<jl_value_t*     (jl_value_t*)>(
-                   reinterpret_cast<jl_value_t* (*) (jl_value_t*)>(helper->negate));
-   dispatch.abs     = std::function<jl_value_t*     (jl_value_t*)>(
-                   reinterpret_cast<jl_value_t* (*) (jl_value_t*)>(helper->abs));
-
-   dispatch.cmp = std::function<long (jl_value_t*, jl_value_t*)>(reinterpret_cast<long(*)(jl_value_t*, jl_value_t*)>(helper->cmp));
-
-   dispatch.to_string   = std::function<char* (jl_value_t*)>(
-                   reinterpret_cast<char* (*)(jl_value_t*)>(helper->to_string));
-   //dispatch.from_string = std::function<jl_value_t* (char*)>(reinterpret_cast<jl_value_t*  (*) (char*)>(helper->from_string));
-
-   dispatch.is_zero = std::function<bool     (jl_value_t*)>(
-                   reinterpret_cast<bool (*) (jl_value_t*)>(helper->is_zero));
-   dispatch.is_one  = std::function<bool     (jl_value_t*)>(
-                   reinterpret_cast<bool (*) (jl_value_t*)>(helper->is_one));
-   //dispatch.is_inf  = std::function<bool     (jl_value_t*)>(
-   //                reinterpret_cast<bool (*) (jl_value_t*)>(helper->is_inf));
-   dispatch.sign    = std::function<long     (jl_value_t*)>(
-                   reinterpret_cast<long (*) (jl_value_t*)>(helper->sign));
-
-   dispatch.hash    = std::function<size_t   (jl_value_t*)>(
-                   reinterpret_cast<size_t (*) (jl_value_t*)>(helper->hash));
-
-   dispatch.to_rational  = std::function<mpq_ptr   (jl_value_t*)>(
-                         reinterpret_cast<mpq_ptr (*) (jl_value_t*)>(helper->to_rational));
-
-   dispatch.to_float     = std::function<double    (jl_value_t*)>(
-                         reinterpret_cast<double  (*) (jl_value_t*)>(helper->to_float));
-
-   oscar_number_map.emplace(index, std::move(dispatch));
+   auto dispatch = std::make_unique<oscar_number_dispatch>();
+   dispatch->index = index;
+   // only the entries provided by the caller are read, all later ones stay null
+   oscar_number_dispatch_helper provided{};
+   std::memcpy(&provided, disp, std::min(helper_size, sizeof(provided)));
+   const oscar_number_dispatch_helper* helper = &provided;
+   set_callback(dispatch->init,          helper->init);
+   set_callback(dispatch->init_from_mpz, helper->init_from_mpz);
+   set_callback(dispatch->copy,          helper->copy);
+
+   // only used once for the root of the arena below
+   set_callback(dispatch->gc_protect,    helper->gc_protect);
+   set_callback(dispatch->gc_free,       helper->gc_free);
+
+   set_callback(dispatch->add,           helper->add);
+   set_callback(dispatch->sub,           helper->sub);
+   set_callback(dispatch->mul,           helper->mul);
+   set_callback(dispatch->div,           helper->div);
+
+   set_callback(dispatch->pow,           helper->pow);
+   set_callback(dispatch->negate,        helper->negate);
+   set_callback(dispatch->abs,           helper->abs);
+
+   set_callback(dispatch->cmp,           helper->cmp);
+
+   set_callback(dispatch->to_string,     helper->to_string);
+   //set_callback(dispatch->from_string,   helper->from_string);
+   dispatch->from_string = nullptr;
+
+   set_callback(dispatch->is_zero,       helper->is_zero);
+   set_callback(dispatch->is_one,        helper->is_one);
+   //set_callback(dispatch->is_inf,        helper->is_inf);
+   dispatch->is_inf = nullptr;
+   set_callback(dispatch->sign,          helper->sign);
+
+   set_callback(dispatch->hash,          helper->hash);
+
+   set_callback(dispatch->to_rational,   helper->to_rational);
+   set_callback(dispatch->to_float,      helper->to_float);
+
+   set_callback(dispatch->addmul,        helper->addmul);
+   set_callback(dispatch->submul,        helper->submul);
+   set_callback(dispatch->cross_diff,    helper->cross_diff);
+
+   set_callback(dispatch->add_inplace,    helper->add_inplace);
+   set_callback(dispatch->sub_inplace,    helper->sub_inplace);
+   set_callback(dispatch->mul_inplace,    helper->mul_inplace);
+   set_callback(dispatch->div_inplace,    helper->div_inplace);
+   set_callback(dispatch->negate_inplace, helper->negate_inplace);
+   set_callback(dispatch->addmul_inplace, helper->addmul_inplace);
+   set_callback(dispatch->submul_inplace, helper->submul_inplace);
+
+   set_callback(dispatch->dot,            helper->dot);
+   set_callback(dispatch->axpy,           helper->axpy);
+   set_callback(dispatch->sign_dot,       helper->sign_dot);
+
+   set_callback(dispatch->add_rational,   helper->add_rational);
+   set_callback(dispatch->sub_rational,   helper->sub_rational);
+   set_callback(dispatch->mul_rational,   helper->mul_rational);
+   set_callback(dispatch->div_rational,   helper->div_rational);
+   set_callback(dispatch->cmp_rational,   helper->cmp_rational);
+
+   set_callback(dispatch->enclose,        helper->enclose);
+
+   set_callback(dispatch->coeffs,         helper->coeffs);
+   set_callback(dispatch->from_coeffs,    helper->from_coeffs);
+   set_callback(dispatch->descriptor,     helper->descriptor);
+   set_callback(dispatch->is_rational,    helper->is_rational);
+   set_callback(dispatch->cross_diff_div, helper->cross_diff_div);
+
+   if (helper->quadratic_root) {
+      if (!dispatch->coeffs || !dispatch->from_coeffs)
+         throw std::runtime_error("polymake::OscarNumber: a native quadratic field needs coeffs and from_coeffs");
+      dispatch->quadratic_root.copy_from(reinterpret_cast<mpq_srcptr>(helper->quadratic_root));
+      if (pm::sign(dispatch->quadratic_root) <= 0)
+         throw std::runtime_error("polymake::OscarNumber: a native quadratic field must be real");
+      dispatch->native = true;
+      // arithmetic is done in C++, the fused, in-place and batched callbacks are never used
+      // and the generic fallbacks run on the native values instead
+      dispatch->addmul = nullptr;
+      dispatch->submul = nullptr;
+      dispatch->cross_diff = nullptr;
+      dispatch->cross_diff_div = nullptr;
+      dispatch->dot = nullptr;
+      dispatch->axpy = nullptr;
+      dispatch->sign_dot = nullptr;
+   }
+
+   dispatch->roots.reset(new rooting_arena(dispatch->gc_protect));
+
+   if (!oscar_number_registry.add(index, dispatch))
+      throw std::runtime_error("polymake::OscarNumber: cannot re-register field index");
 }
 
 } }
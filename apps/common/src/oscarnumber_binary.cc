@@ -0,0 +1,223 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#include "polymake/client.h"
+#include "polymake/common/oscarnumber_binary.h"
+
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace polymake { namespace common {
+
+namespace {
+
+constexpr char magic[4] = { 'O', 'S', 'C', 'N' };
+constexpr uint32_t format_version = 1;
+
+template <typename T>
+void put(std::string& out, const T& x)
+{
+   out.append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+template <typename T>
+T get(const char*& pos, const char* end)
+{
+   if (size_t(end - pos) < sizeof(T))
+      throw std::runtime_error("OscarNumberBinaryReader: truncated file");
+   T x;
+   std::memcpy(&x, pos, sizeof(T));
+   pos += sizeof(T);
+   return x;
+}
+
+}
+
+OscarNumberBinaryWriter::OscarNumberBinaryWriter(std::ostream& os_, long field_index_, Int cols_) :
+   os(os_), field_index(field_index_), n_cols(cols_)
+{
+   const std::string descriptor = field_index ? OscarNumber::field_descriptor(field_index) : std::string();
+   buffer.append(magic, sizeof(magic));
+   put(buffer, format_version);
+   put(buffer, uint32_t(sizeof(mp_limb_t)));
+   put(buffer, uint32_t(0));
+   put(buffer, uint64_t(descriptor.size()));
+   buffer.append(descriptor);
+   put(buffer, uint64_t(n_cols));
+   os.write(buffer.data(), buffer.size());
+   offset = buffer.size();
+}
+
+void OscarNumberBinaryWriter::write_buffer()
+{
+   if (finished)
+      throw std::runtime_error("OscarNumberBinaryWriter: already finished");
+   row_offsets.push_back(offset);
+   os.write(buffer.data(), buffer.size());
+   offset += buffer.size();
+   if (!os)
+      throw std::runtime_error("OscarNumberBinaryWriter: write error");
+}
+
+void OscarNumberBinaryWriter::finish()
+{
+   if (finished)
+      return;
+   buffer.clear();
+   for (uint64_t o : row_offsets)
+      put(buffer, o);
+   put(buffer, uint64_t(row_offsets.size()));
+   put(buffer, offset);
+   buffer.append(magic, sizeof(magic));
+   os.write(buffer.data(), buffer.size());
+   os.flush();
+   if (!os)
+      throw std::runtime_error("OscarNumberBinaryWriter: write error");
+   finished = true;
+}
+
+OscarNumberBinaryReader::OscarNumberBinaryReader(const std::string& filename, long field_index) :
+   index(field_index)
+{
+   const int fd = ::open(filename.c_str(), O_RDONLY);
+   if (fd < 0)
+      throw std::runtime_error("OscarNumberBinaryReader: can't open " + filename);
+   struct stat st;
+   if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("OscarNumberBinaryReader: can't stat " + filename);
+   }
+   size = st.st_size;
+   void* map = size ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+   ::close(fd);
+   if (map == MAP_FAILED)
+      throw std::runtime_error("OscarNumberBinaryReader: can't map " + filename);
+   data = static_cast<const char*>(map);
+
+   try {
+      const char* const end = data + size;
+      const char* pos = data;
+      if (size < 2 * sizeof(magic) || std::memcmp(pos, magic, sizeof(magic)) != 0 ||
+          std::memcmp(end - sizeof(magic), magic, sizeof(magic)) != 0)
+         throw std::runtime_error("OscarNumberBinaryReader: not a complete OscarNumber file: " + filename);
+      pos += sizeof(magic);
+      if (get<uint32_t>(pos, end) != format_version)
+         throw std::runtime_error("OscarNumberBinaryReader: unsupported format version");
+      if (get<uint32_t>(pos, end) != sizeof(mp_limb_t))
+         throw std::runtime_error("OscarNumberBinaryReader: incompatible limb size");
+      get<uint32_t>(pos, end);
+      const uint64_t descriptor_size = get<uint64_t>(pos, end);
+      if (uint64_t(end - pos) < descriptor_size)
+         throw std::runtime_error("OscarNumberBinaryReader: truncated file");
+      const std::string descriptor(pos, descriptor_size);
+      pos += descriptor_size;
+      const uint64_t cols = get<uint64_t>(pos, end);
+      // each entry takes at least its tag byte
+      if (cols > size)
+         throw std::runtime_error("OscarNumberBinaryReader: corrupt number of columns");
+      n_cols = cols;
+
+      if (!descriptor.empty()) {
+         if (!index)
+            throw std::runtime_error("OscarNumberBinaryReader: file contains field elements, a field is required");
+         const std::string expected = OscarNumber::field_descriptor(index);
+         if (!expected.empty() && expected != descriptor)
+            throw std::runtime_error("OscarNumberBinaryReader: field does not match the file");
+      }
+
+      const char* footer_end = end - sizeof(magic);
+      const char* p = footer_end - 2 * sizeof(uint64_t);
+      if (p < pos)
+         throw std::runtime_error("OscarNumberBinaryReader: truncated file");
+      n_rows = get<uint64_t>(p, footer_end);
+      const uint64_t footer = get<uint64_t>(p, footer_end);
+      if (uint64_t(n_rows) > size / sizeof(uint64_t) ||
+          footer < uint64_t(pos - data) || footer + (n_rows + 2) * sizeof(uint64_t) + sizeof(magic) != size)
+         throw std::runtime_error("OscarNumberBinaryReader: corrupt row index");
+      row_index = data + footer;
+      rows_end = row_index;
+   }
+   catch (...) {
+      ::munmap(const_cast<char*>(data), size);
+      throw;
+   }
+}
+
+OscarNumberBinaryReader::~OscarNumberBinaryReader()
+{
+   ::munmap(const_cast<char*>(data), size);
+}
+
+const char* OscarNumberBinaryReader::row_begin(Int i) const
+{
+   uint64_t o;
+   std::memcpy(&o, row_index + i * sizeof(uint64_t), sizeof(o));
+   if (o > uint64_t(rows_end - data))
+      throw std::runtime_error("OscarNumberBinaryReader: corrupt row index");
+   return data + o;
+}
+
+Vector<OscarNumber> OscarNumberBinaryReader::row(Int i) const
+{
+   if (i < 0 || i >= n_rows)
+      throw std::runtime_error("OscarNumberBinaryReader: row index out of range");
+   Vector<OscarNumber> v(n_cols);
+   const char* pos = row_begin(i);
+   for (Int j = 0; j < n_cols; ++j)
+      v[j] = OscarNumber::from_serialized(pos, rows_end, index);
+   return v;
+}
+
+Matrix<OscarNumber> OscarNumberBinaryReader::matrix() const
+{
+   Matrix<OscarNumber> M(n_rows, n_cols);
+   for (Int i = 0; i < n_rows; ++i) {
+      const char* pos = row_begin(i);
+      for (Int j = 0; j < n_cols; ++j)
+         M(i, j) = OscarNumber::from_serialized(pos, rows_end, index);
+   }
+   return M;
+}
+
+void write_binary(const std::string& filename, const Matrix<OscarNumber>& M)
+{
+   std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+   if (!os)
+      throw std::runtime_error("OscarNumberBinaryWriter: can't create " + filename);
+   write_binary(os, M);
+}
+
+UserFunction4perl("# @category Utilities"
+                  "# Write a matrix over an oscar field to a file in a compact binary format,"
+                  "# rows can be read back individually without parsing the whole file."
+                  "# @param String filename"
+                  "# @param Matrix<OscarNumber> M",
+                  static_cast<void (*)(const std::string&, const Matrix<OscarNumber>&)>(&write_binary),
+                  "write_oscarnumber_binary($ Matrix<OscarNumber>)");
+
+UserFunction4perl("# @category Utilities"
+                  "# Read a matrix written by [[write_oscarnumber_binary]]."
+                  "# @param String filename"
+                  "# @param Int index the index of the field of the entries, 0 if all entries are rational"
+                  "# @return Matrix<OscarNumber>",
+                  &read_binary, "read_oscarnumber_binary($; $=0)");
+
+} }
@@ -0,0 +1,144 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#include <julia/julia.h>
+
+#include "polymake/client.h"
+#include "polymake/common/oscarnumber_dense.h"
+
+namespace polymake { namespace common {
+
+OscarNumberDenseStorage::OscarNumberDenseStorage(Int n_) :
+   n(n_), rational_bits((n_ + 63) / 64, ~uint64_t(0)) {}
+
+OscarNumberDenseStorage::OscarNumberDenseStorage(const OscarNumberDenseStorage& s) :
+   n(s.n), rational_bits(s.rational_bits), rationals(s.rationals)
+{
+   if (s.entries) {
+      entries = OscarNumber::new_container(s.index, n, slot, s.entries);
+      index = s.index;
+   }
+}
+
+OscarNumberDenseStorage::OscarNumberDenseStorage(OscarNumberDenseStorage&& s) noexcept :
+   n(s.n), index(s.index), entries(s.entries), slot(s.slot),
+   rational_bits(std::move(s.rational_bits)), rationals(std::move(s.rationals))
+{
+   s.n = 0;
+   s.index = 0;
+   s.entries = nullptr;
+}
+
+OscarNumberDenseStorage& OscarNumberDenseStorage::operator= (OscarNumberDenseStorage s) noexcept
+{
+   swap(s);
+   return *this;
+}
+
+OscarNumberDenseStorage::~OscarNumberDenseStorage()
+{
+   if (entries)
+      OscarNumber::release_container(index, slot);
+}
+
+void OscarNumberDenseStorage::swap(OscarNumberDenseStorage& s) noexcept
+{
+   std::swap(n, s.n);
+   std::swap(index, s.index);
+   std::swap(entries, s.entries);
+   std::swap(slot, s.slot);
+   rational_bits.swap(s.rational_bits);
+   rationals.swap(s.rationals);
+}
+
+void OscarNumberDenseStorage::attach_field(long field)
+{
+   entries = OscarNumber::new_container(field, n, slot);
+   index = field;
+}
+
+void* OscarNumberDenseStorage::entry(Int i) const
+{
+   return jl_array_ptr_ref(entries, i);
+}
+
+OscarNumber OscarNumberDenseStorage::get(Int i) const
+{
+   if (is_rational(i)) {
+      const auto r = rationals.find(i);
+      return r == rationals.end() ? OscarNumber() : OscarNumber(r->second);
+   }
+   OscarNumber x;
+   void* e = entry(i);
+   OscarNumber::from_julia(&e, 1, index, &x);
+   return x;
+}
+
+void OscarNumberDenseStorage::get(Int i, Int m, OscarNumber* out) const
+{
+   std::vector<void*> elems;
+   std::vector<Int> pos;
+   for (Int k = 0; k < m; ++k) {
+      if (is_rational(i + k)) {
+         const auto r = rationals.find(i + k);
+         if (r == rationals.end())
+            out[k] = 0;
+         else
+            out[k] = r->second;
+      } else {
+         elems.push_back(entry(i + k));
+         pos.push_back(k);
+      }
+   }
+   if (elems.empty())
+      return;
+   std::vector<OscarNumber> x(elems.size());
+   OscarNumber::from_julia(elems.data(), elems.size(), index, x.data());
+   for (size_t k = 0; k < pos.size(); ++k)
+      out[pos[k]] = std::move(x[k]);
+}
+
+void OscarNumberDenseStorage::set_rational(Int i, Rational&& x)
+{
+   if (is_zero(x))
+      rationals.erase(i);
+   else
+      rationals[i] = std::move(x);
+   // drop the field element stored before
+   if (!is_rational(i)) {
+      OscarNumber::container_store(entries, i, nullptr);
+      rational_bits[i / 64] |= uint64_t(1) << (i % 64);
+   }
+}
+
+void OscarNumberDenseStorage::set(Int i, const OscarNumber& x)
+{
+   // infinities of the field are the same as the rational ones
+   if (x.uses_rational() || x.is_inf()) {
+      set_rational(i, Rational(x));
+      return;
+   }
+   if (!entries)
+      attach_field(x.field_index());
+   else if (x.field_index() != index)
+      throw std::runtime_error("oscar_number_wrap: different julia fields!");
+   OscarNumber::container_store(entries, i, &x);
+   rational_bits[i / 64] &= ~(uint64_t(1) << (i % 64));
+   rationals.erase(i);
+}
+
+} }
@@ -0,0 +1,68 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#include "polymake/client.h"
+#include "polymake/Map.h"
+#include "polymake/common/OscarNumber.h"
+
+namespace polymake { namespace common {
+
+void oscarnumber_instrumentation(bool enable)
+{
+   OscarNumber::set_instrumentation(enable);
+}
+
+Map<std::string, std::pair<Int, Int>> oscarnumber_call_stats(Int index)
+{
+   Map<std::string, std::pair<Int, Int>> stats;
+   for (const OscarNumberCallStats& s : OscarNumber::call_stats(index))
+      if (s.calls)
+         stats[s.name] = std::make_pair(s.calls, s.ns);
+   return stats;
+}
+
+void reset_oscarnumber_call_stats(Int index)
+{
+   OscarNumber::reset_call_stats(index);
+}
+
+UserFunction4perl("# @category Utilities"
+                  "# Switch the instrumentation of the julia callbacks of all oscar fields on or off."
+                  "# It is off by default, see [[oscarnumber_call_stats]]."
+                  "# @param Bool enable",
+                  &oscarnumber_instrumentation, "oscarnumber_instrumentation($)");
+
+UserFunction4perl("# @category Utilities"
+                  "# Number of calls and total time in nanoseconds of each julia callback of an oscar field,"
+                  "# recorded while the instrumentation was switched on."
+                  "# The entries \"upgrade\", \"demotion\" and \"shared_write\" count rationals upgraded to"
+                  "# field elements, rational results converted back to rationals and shared elements"
+                  "# which had to be replaced instead of being updated in place."
+                  "# The entries starting with \"OscarNumber::\" hold the calls and total time of the public"
+                  "# operations on elements of the field, e.g. \"OscarNumber::+=\" or \"OscarNumber::cmp\","
+                  "# including the callbacks they make; the difference is the cost of the C++ layer."
+                  "# Callbacks which were never called are left out."
+                  "# @param Int index the index of the field"
+                  "# @return Map<String, Pair<Int,Int>>",
+                  &oscarnumber_call_stats, "oscarnumber_call_stats($)");
+
+UserFunction4perl("# @category Utilities"
+                  "# Reset the instrumentation counters of an oscar field."
+                  "# @param Int index the index of the field",
+                  &reset_oscarnumber_call_stats, "reset_oscarnumber_call_stats($)");
+
+} }
@@ -0,0 +1,288 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#include "polymake/client.h"
+#include "polymake/Matrix.h"
+#include "polymake/Vector.h"
+#include "polymake/linalg.h"
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_linalg.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace polymake { namespace common { namespace oscarnumber_linalg {
+
+namespace {
+
+// minimal number of entry updates handed to one thread
+constexpr Int parallel_grain = 256;
+
+Int grain_for(Int row_length)
+{
+   return std::max(Int(1), parallel_grain / std::max(Int(1), row_length));
+}
+
+// outcome of fraction_free_eliminate
+struct elimination {
+   // order of the rows, the pivot rows come first
+   std::vector<Int> row_index;
+   // column of the pivot in each pivot row
+   std::vector<Int> pivot_cols;
+   // the last pivot, i.e. the determinant of the pivot rows and columns up to sign
+   OscarNumber last_pivot{1};
+   // odd number of row exchanges
+   bool negated = false;
+};
+
+// Fraction-free elimination (Bareiss) of M in place, pivots are only chosen in the
+// first pivot_limit columns.  Each entry update is (a*b - c*d) / previous pivot, a single
+// julia call for fields providing the fused cross_diff_div, otherwise a cross_diff times
+// the inverse of the previous pivot, so there is only one inversion per step instead of
+// one division per entry.  All entries stay minors of the input, which keeps the
+// coefficients of field elements from blowing up.
+// With jordan the rows above the pivots are reduced as well (Gauss-Jordan), afterwards
+// all pivots are equal to the last one.
+// With stop_if_singular the elimination ends at the first column without a pivot.
+// With keep_multipliers the entries below a pivot are not cleared, they are the column of L
+// of the fraction-free LU decomposition, see fraction_free_lu.
+// The rows which are updated in one step are distributed over oscarnumber_threads() threads.
+elimination fraction_free_eliminate(Matrix<OscarNumber>& M, Int pivot_limit, bool jordan, bool stop_if_singular,
+                                    bool keep_multipliers = false)
+{
+   const Int n_rows = M.rows(), n_cols = M.cols();
+   elimination result;
+   result.row_index.resize(n_rows);
+   std::iota(result.row_index.begin(), result.row_index.end(), 0);
+   if (!n_rows || !n_cols)
+      return result;
+   std::vector<Int>& row_index = result.row_index;
+   OscarNumber* const entries = &M(0, 0);
+
+   Int rank = 0;
+   for (Int c = 0; c < pivot_limit && rank < n_rows; ++c) {
+      Int r = rank;
+      while (r < n_rows && entries[row_index[r] * n_cols + c].is_zero())
+         ++r;
+      if (r == n_rows) {
+         if (stop_if_singular)
+            return result;
+         continue;
+      }
+      if (r != rank) {
+         std::swap(row_index[r], row_index[rank]);
+         result.negated = !result.negated;
+      }
+      const OscarNumber* const prow = entries + row_index[rank] * n_cols;
+      const OscarNumber pivot = prow[c];
+      const OscarNumber& prev = result.last_pivot;
+      // the only inversion of this step
+      OscarNumber inv_prev(1);
+      inv_prev /= prev;
+      // factor applied to the rows without an entry in the pivot column
+      const OscarNumber scale = pivot * inv_prev;
+
+      // below the pivot the columns left of c are zero in all rows
+      const Int first = jordan ? 0 : rank+1;
+      const Int pivot_pos = rank;
+      oscarnumber_parallel_for(n_rows - first, grain_for(n_cols - c), [&](Int begin, Int end) {
+         for (Int k = first + begin; k < first + end; ++k) {
+            if (k == pivot_pos) continue;
+            OscarNumber* row = entries + row_index[k] * n_cols;
+            const Int from = k < pivot_pos ? 0 : c+1;
+            const OscarNumber factor = row[c];
+            if (factor.is_zero()) {
+               for (Int j = from; j < n_cols; ++j)
+                  if (j != c && !row[j].is_zero())
+                     row[j] *= scale;
+            } else {
+               for (Int j = from; j < n_cols; ++j) {
+                  if (j == c) continue;
+                  row[j] = cross_diff_div(pivot, row[j], factor, prow[j], prev, inv_prev);
+               }
+               if (!keep_multipliers)
+                  row[c] = 0;
+            }
+         }
+      });
+      result.pivot_cols.push_back(c);
+      result.last_pivot = pivot;
+      ++rank;
+   }
+   return result;
+}
+
+// copy of the columns [from, from + n) of M
+Matrix<OscarNumber> columns(const Matrix<OscarNumber>& M, Int from, Int n)
+{
+   Matrix<OscarNumber> R(M.rows(), n);
+   for (Int i = 0; i < M.rows(); ++i)
+      for (Int j = 0; j < n; ++j)
+         R(i, j) = M(i, from + j);
+   return R;
+}
+
+}
+
+bool uses_rational(const Matrix<OscarNumber>& M)
+{
+   for (Int i = 0; i < M.rows(); ++i)
+      for (Int j = 0; j < M.cols(); ++j)
+         if (!M(i, j).uses_rational())
+            return false;
+   return true;
+}
+
+bool uses_rational(const Vector<OscarNumber>& v)
+{
+   for (Int i = 0; i < v.dim(); ++i)
+      if (!v[i].uses_rational())
+         return false;
+   return true;
+}
+
+OscarNumber det(Matrix<OscarNumber> M)
+{
+   if (uses_rational(M))
+      return OscarNumber(pm::det(Matrix<Rational>(M)));
+   OscarNumberScope scope;
+   const Int dim = M.rows();
+   if (!dim)
+      return OscarNumber(0);
+   const elimination e = fraction_free_eliminate(M, dim, false, true);
+   if (Int(e.pivot_cols.size()) < dim)
+      return OscarNumber(0);
+   OscarNumber result(e.last_pivot);
+   if (e.negated)
+      result.negate();
+   return result;
+}
+
+Int rank(const Matrix<OscarNumber>& M)
+{
+   if (uses_rational(M))
+      return pm::rank(Matrix<Rational>(M));
+   OscarNumberScope scope;
+   if (!M.rows() || !M.cols())
+      return 0;
+   // eliminate along the shorter dimension
+   Matrix<OscarNumber> A = M.rows() < M.cols() ? Matrix<OscarNumber>(T(M)) : M;
+   return fraction_free_eliminate(A, A.cols(), false, false).pivot_cols.size();
+}
+
+Matrix<OscarNumber> null_space(const Matrix<OscarNumber>& M)
+{
+   if (uses_rational(M))
+      return Matrix<OscarNumber>(pm::null_space(Matrix<Rational>(M)));
+   OscarNumberScope scope;
+   const Int n = M.cols();
+   Matrix<OscarNumber> A(M);
+   const elimination e = fraction_free_eliminate(A, n, true, false);
+   const Int r = e.pivot_cols.size();
+
+   // one basis vector for each column without a pivot, normalized to 1 in this column
+   OscarNumber inv_pivot(1);
+   if (r)
+      inv_pivot /= e.last_pivot;
+   Matrix<OscarNumber> N(n - r, n);
+   Int i = 0;
+   for (Int f = 0, p = 0; f < n; ++f) {
+      if (p < r && e.pivot_cols[p] == f) {
+         ++p;
+         continue;
+      }
+      N(i, f) = 1;
+      for (Int k = 0; k < r; ++k) {
+         const OscarNumber& x = A(e.row_index[k], f);
+         if (!x.is_zero())
+            N(i, e.pivot_cols[k]) = -(x * inv_pivot);
+      }
+      ++i;
+   }
+   return N;
+}
+
+Matrix<OscarNumber> inv(const Matrix<OscarNumber>& M)
+{
+   if (uses_rational(M))
+      return Matrix<OscarNumber>(pm::inv(Matrix<Rational>(M)));
+   OscarNumberScope scope;
+   const Int dim = M.rows();
+   // fraction-free Gauss-Jordan on (M | 1), the right half ends up as det(M) * M^-1
+   Matrix<OscarNumber> A(dim, 2*dim);
+   for (Int i = 0; i < dim; ++i) {
+      for (Int j = 0; j < dim; ++j)
+         A(i, j) = M(i, j);
+      A(i, dim+i) = 1;
+   }
+   const elimination e = fraction_free_eliminate(A, dim, true, true);
+   if (Int(e.pivot_cols.size()) < dim)
+      throw degenerate_matrix();
+
+   OscarNumber inv_det(1);
+   if (dim)
+      inv_det /= e.last_pivot;
+   Matrix<OscarNumber> R(dim, dim);
+   for (Int i = 0; i < dim; ++i)
+      for (Int j = 0; j < dim; ++j) {
+         const OscarNumber& x = A(e.row_index[i], dim+j);
+         if (!x.is_zero())
+            R(i, j) = x * inv_det;
+      }
+   return R;
+}
+
+lu_decomposition fraction_free_lu(const Matrix<OscarNumber>& M)
+{
+   OscarNumberScope scope;
+   const Int dim = M.rows();
+   if (M.cols() != dim)
+      throw std::runtime_error("fraction_free_lu - non-square matrix");
+   Matrix<OscarNumber> A(M);
+   const elimination e = fraction_free_eliminate(A, dim, false, true, true);
+   if (Int(e.pivot_cols.size()) < dim)
+      throw degenerate_matrix();
+
+   lu_decomposition result;
+   result.L = Matrix<OscarNumber>(dim, dim);
+   result.U = Matrix<OscarNumber>(dim, dim);
+   result.row_perm = e.row_index;
+   for (Int i = 0; i < dim; ++i) {
+      const Int r = e.row_index[i];
+      for (Int j = 0; j < i; ++j)
+         result.L(i, j) = A(r, j);
+      result.L(i, i) = A(r, i);
+      for (Int j = i; j < dim; ++j)
+         result.U(i, j) = A(r, j);
+   }
+   return result;
+}
+
+Matrix<OscarNumber> lineality_space(const Matrix<OscarNumber>& M)
+{
+   if (!M.cols())
+      return Matrix<OscarNumber>();
+   // the homogenizing coordinate of the lineality space is zero
+   const Matrix<OscarNumber> N = null_space(columns(M, 1, M.cols()-1));
+   Matrix<OscarNumber> L(N.rows(), M.cols());
+   for (Int i = 0; i < N.rows(); ++i)
+      for (Int j = 0; j < N.cols(); ++j)
+         L(i, j+1) = N(i, j);
+   return L;
+}
+
+} } }
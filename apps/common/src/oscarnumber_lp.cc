@@ -0,0 +1,410 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#include "polymake/client.h"
+#include "polymake/Matrix.h"
+#include "polymake/Vector.h"
+#include "polymake/linalg.h"
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_linalg.h"
+#include "polymake/common/oscarnumber_lp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <type_traits>
+
+namespace polymake { namespace common {
+
+namespace {
+
+// minimal number of entry updates handed to one thread
+constexpr Int parallel_grain = 256;
+
+Int grain_for(Int row_length)
+{
+   return std::max(Int(1), parallel_grain / std::max(Int(1), row_length));
+}
+
+// the floating point pass only has to find a basis, which is checked exactly afterwards
+constexpr double float_eps = 1e-9;
+
+inline Int lp_sign(double x) { return x > float_eps ? 1 : x < -float_eps ? -1 : 0; }
+inline Int lp_sign(const OscarNumber& x) { return x.sign(); }
+
+inline bool lp_is_zero(double x) { return std::abs(x) <= float_eps; }
+inline bool lp_is_zero(const OscarNumber& x) { return x.is_zero(); }
+
+inline void sub_mul(double& x, double a, double b) { x -= a * b; }
+inline void sub_mul(OscarNumber& x, const OscarNumber& a, const OscarNumber& b) { x.sub_mul(a, b); }
+
+// The LP in standard form max c*y, A*y = b, y >= 0 with b >= 0, the columns of y are
+// (x+, x-, slacks, artificials) with x = x+ - x-, the artificial columns form the identity.
+template <typename E>
+struct standard_form {
+   // coordinates of x, rows, columns without the artificials
+   Int n = 0, m = 0, cols = 0;
+   // cols + m + 1, the last entry of each row is b
+   Int width = 0;
+   std::vector<E> rows;
+   std::vector<E> c;
+
+   const E& at(Int i, Int j) const { return rows[i * width + j]; }
+};
+
+standard_form<OscarNumber> make_standard_form(const Matrix<OscarNumber>& Inequalities,
+                                              const Matrix<OscarNumber>& Equations,
+                                              const Vector<OscarNumber>& Objective, bool maximize)
+{
+   const Int d = Objective.dim();
+   if (!d)
+      throw std::runtime_error("solve_lp - empty objective");
+   if ((Inequalities.rows() && Inequalities.cols() != d) || (Equations.rows() && Equations.cols() != d))
+      throw std::runtime_error("solve_lp - dimension mismatch");
+
+   standard_form<OscarNumber> f;
+   const Int m_ineq = Inequalities.rows();
+   f.n = d - 1;
+   f.m = m_ineq + Equations.rows();
+   f.cols = 2 * f.n + m_ineq;
+   f.width = f.cols + f.m + 1;
+   f.rows.resize(f.m * f.width);
+   for (Int i = 0; i < f.m; ++i) {
+      const bool ineq = i < m_ineq;
+      auto h = [&](Int j) -> const OscarNumber& {
+         return ineq ? Inequalities(i, j) : Equations(i - m_ineq, j);
+      };
+      // h_0 + h*x >= 0 (or = 0) becomes h*x+ - h*x- - s = -h_0, negated if h_0 > 0
+      const bool negated = h(0).sign() > 0;
+      OscarNumber* row = &f.rows[i * f.width];
+      for (Int j = 0; j < f.n; ++j) {
+         if (h(j+1).is_zero()) continue;
+         row[j] = negated ? -h(j+1) : h(j+1);
+         row[f.n + j] = -row[j];
+      }
+      if (ineq)
+         row[2 * f.n + i] = negated ? 1 : -1;
+      row[f.cols + i] = 1;
+      row[f.width - 1] = negated ? h(0) : -h(0);
+   }
+   f.c.resize(f.width - 1);
+   for (Int j = 0; j < f.n; ++j) {
+      if (Objective[j+1].is_zero()) continue;
+      f.c[j] = maximize ? Objective[j+1] : -Objective[j+1];
+      f.c[f.n + j] = -f.c[j];
+   }
+   return f;
+}
+
+standard_form<double> approximate(const standard_form<OscarNumber>& f)
+{
+   standard_form<double> a;
+   a.n = f.n;
+   a.m = f.m;
+   a.cols = f.cols;
+   a.width = f.width;
+   a.rows.reserve(f.rows.size());
+   for (const OscarNumber& x : f.rows)
+      a.rows.push_back(x.is_zero() ? 0.0 : double(x));
+   a.c.reserve(f.c.size());
+   for (const OscarNumber& x : f.c)
+      a.c.push_back(x.is_zero() ? 0.0 : double(x));
+   return a;
+}
+
+enum class simplex_result { optimal, unbounded, aborted };
+
+// dense two-phase simplex tableau, pivoting with Bland's rule
+template <typename E>
+class tableau {
+   public:
+      // starts from the artificial basis
+      explicit tableau(const standard_form<E>& f_) :
+         f(f_), T(f_.rows), basis(f_.m), is_basic(f_.width - 1, false), redundant(f_.m, false)
+      {
+         std::iota(basis.begin(), basis.end(), f.cols);
+         for (Int i = 0; i < f.m; ++i)
+            is_basic[f.cols + i] = true;
+      }
+
+      // T = A_B^-1 (A | b), false if A_B is singular or the basis is infeasible
+      bool start_from(const std::vector<Int>& B);
+
+      // false if the pivot budget (unlimited if negative) ran out
+      bool run(Int budget, OscarNumberLPStatus& status)
+      {
+         bool positive_artificial = false;
+         for (Int i = 0; i < f.m; ++i)
+            positive_artificial |= basis[i] >= f.cols && lp_sign(rhs(i)) > 0;
+         if (positive_artificial) {
+            // phase one: maximize minus the sum of the artificials
+            std::vector<E> c1(f.width - 1);
+            for (Int i = 0; i < f.m; ++i)
+               c1[f.cols + i] = -1;
+            if (iterate(c1, true, budget) != simplex_result::optimal)
+               return false;
+            for (Int i = 0; i < f.m; ++i) {
+               if (basis[i] >= f.cols && lp_sign(rhs(i)) > 0) {
+                  status = OscarNumberLPStatus::infeasible;
+                  return true;
+               }
+            }
+         }
+         drive_out_artificials();
+         const simplex_result r = iterate(f.c, false, budget);
+         if (r == simplex_result::aborted)
+            return false;
+         status = r == simplex_result::optimal ? OscarNumberLPStatus::valid : OscarNumberLPStatus::unbounded;
+         return true;
+      }
+
+      // x with the leading homogenizing coordinate
+      Vector<E> solution() const
+      {
+         Vector<E> x(f.n + 1);
+         x[0] = 1;
+         for (Int i = 0; i < f.m; ++i) {
+            if (redundant[i]) continue;
+            if (basis[i] < f.n)
+               x[basis[i] + 1] += rhs(i);
+            else if (basis[i] < 2 * f.n)
+               x[basis[i] - f.n + 1] -= rhs(i);
+         }
+         return x;
+      }
+
+      const std::vector<Int>& current_basis() const { return basis; }
+      Int pivots = 0;
+
+   private:
+      E& at(Int i, Int j) { return T[i * f.width + j]; }
+      const E& at(Int i, Int j) const { return T[i * f.width + j]; }
+      const E& rhs(Int i) const { return at(i, f.width - 1); }
+
+      void reset_basis(const std::vector<Int>& B)
+      {
+         basis = B;
+         std::fill(is_basic.begin(), is_basic.end(), false);
+         for (Int j : basis)
+            is_basic[j] = true;
+         std::fill(redundant.begin(), redundant.end(), false);
+      }
+
+      simplex_result iterate(const std::vector<E>& c, bool phase_one, Int& budget)
+      {
+         // artificials may only enter in phase one
+         const Int last = phase_one ? f.width - 1 : f.cols;
+         std::vector<Int> cost_rows;
+         for (;;) {
+            cost_rows.clear();
+            for (Int i = 0; i < f.m; ++i)
+               if (!lp_is_zero(c[basis[i]]))
+                  cost_rows.push_back(i);
+
+            // the first column with a positive reduced cost enters
+            Int enter = -1;
+            for (Int j = 0; j < last && enter < 0; ++j) {
+               if (is_basic[j]) continue;
+               E r = c[j];
+               for (Int i : cost_rows)
+                  if (!lp_is_zero(at(i, j)))
+                     sub_mul(r, c[basis[i]], at(i, j));
+               if (lp_sign(r) > 0)
+                  enter = j;
+            }
+            if (enter < 0)
+               return simplex_result::optimal;
+
+            // minimal ratio rhs / entry, ties broken by the smallest basic column
+            Int leave = -1;
+            for (Int i = 0; i < f.m; ++i) {
+               if (redundant[i] || lp_sign(at(i, enter)) <= 0) continue;
+               if (leave < 0) {
+                  leave = i;
+               } else {
+                  const Int s = lp_sign(rhs(i) * at(leave, enter) - rhs(leave) * at(i, enter));
+                  if (s < 0 || (s == 0 && basis[i] < basis[leave]))
+                     leave = i;
+               }
+            }
+            if (leave < 0)
+               return simplex_result::unbounded;
+            if (budget == 0)
+               return simplex_result::aborted;
+            if (budget > 0)
+               --budget;
+            pivot(leave, enter);
+         }
+      }
+
+      // artificials still basic after phase one are zero, they are replaced by a
+      // regular column if possible, otherwise their row is a redundant equation
+      void drive_out_artificials()
+      {
+         for (Int i = 0; i < f.m; ++i) {
+            if (basis[i] < f.cols || redundant[i]) continue;
+            Int j = 0;
+            while (j < f.cols && (is_basic[j] || lp_is_zero(at(i, j))))
+               ++j;
+            if (j < f.cols)
+               pivot(i, j);
+            else
+               redundant[i] = true;
+         }
+      }
+
+      void pivot(Int r, Int col)
+      {
+         E* const prow = &at(r, 0);
+         E inv(1);
+         inv /= prow[col];
+         for (Int j = 0; j < f.width; ++j)
+            if (!lp_is_zero(prow[j]))
+               prow[j] *= inv;
+         prow[col] = 1;
+         auto eliminate = [&](Int begin, Int end) {
+            for (Int i = begin; i < end; ++i) {
+               if (i == r) continue;
+               E* const row = &at(i, 0);
+               const E factor = row[col];
+               if (lp_is_zero(factor)) continue;
+               for (Int j = 0; j < f.width; ++j)
+                  if (!lp_is_zero(prow[j]))
+                     sub_mul(row[j], factor, prow[j]);
+               row[col] = 0;
+            }
+         };
+         if (std::is_same<E, OscarNumber>::value)
+            oscarnumber_parallel_for(f.m, grain_for(f.width), eliminate);
+         else
+            eliminate(0, f.m);
+         is_basic[basis[r]] = false;
+         basis[r] = col;
+         is_basic[col] = true;
+         ++pivots;
+      }
+
+      const standard_form<E>& f;
+      std::vector<E> T;
+      std::vector<Int> basis;
+      std::vector<bool> is_basic;
+      std::vector<bool> redundant;
+};
+
+template <>
+bool tableau<OscarNumber>::start_from(const std::vector<Int>& B)
+{
+   const Int m = f.m;
+   if (Int(B.size()) != m)
+      return false;
+   if (!m) {
+      // no constraints, nothing to invert
+      T.clear();
+      reset_basis(B);
+      return true;
+   }
+   Matrix<OscarNumber> AB(m, m);
+   for (Int i = 0; i < m; ++i)
+      for (Int k = 0; k < m; ++k)
+         AB(i, k) = f.at(i, B[k]);
+   Matrix<OscarNumber> Binv;
+   try {
+      Binv = oscarnumber_linalg::inv(AB);
+   }
+   catch (const degenerate_matrix&) {
+      return false;
+   }
+   const Matrix<OscarNumber>& Bi = Binv;
+   std::vector<OscarNumber> R(m * f.width);
+   oscarnumber_parallel_for(m, grain_for(m * f.width), [&](Int begin, Int end) {
+      for (Int i = begin; i < end; ++i)
+         for (Int k = 0; k < m; ++k)
+            if (!Bi(i, k).is_zero())
+               OscarNumber::add_scaled(&R[i * f.width], Bi(i, k), &f.rows[k * f.width], f.width);
+   });
+   for (Int i = 0; i < m; ++i)
+      if (R[i * f.width + f.width - 1].sign() < 0)
+         return false;
+   T.swap(R);
+   reset_basis(B);
+   return true;
+}
+
+}
+
+OscarNumberLPSolution solve_lp(const Matrix<OscarNumber>& Inequalities,
+                               const Matrix<OscarNumber>& Equations,
+                               const Vector<OscarNumber>& Objective, bool maximize)
+{
+   OscarNumberScope scope;
+   const standard_form<OscarNumber> exact = make_standard_form(Inequalities, Equations, Objective, maximize);
+   OscarNumberLPSolution result;
+
+   // basis found in floating point, with a budget against cycling caused by rounding
+   std::vector<Int> hint;
+   bool have_hint = false;
+   {
+      const standard_form<double> approx = approximate(exact);
+      tableau<double> t(approx);
+      OscarNumberLPStatus status = OscarNumberLPStatus::infeasible;
+      have_hint = t.run(50 * (approx.m + approx.width), status);
+      if (have_hint)
+         hint = t.current_basis();
+      result.float_pivots = t.pivots;
+   }
+
+   tableau<OscarNumber> t(exact);
+   const bool warm = have_hint && t.start_from(hint);
+   t.run(-1, result.status);
+   result.exact_pivots = t.pivots;
+   result.certified = warm && t.pivots == 0;
+   if (result.status == OscarNumberLPStatus::valid) {
+      result.solution = t.solution();
+      result.objective_value = Objective[0];
+      for (Int j = 1; j < Objective.dim(); ++j)
+         result.objective_value.add_mul(Objective[j], result.solution[j]);
+   }
+   return result;
+}
+
+std::pair<OscarNumber, Vector<OscarNumber>>
+oscarnumber_solve_lp(const Matrix<OscarNumber>& Inequalities, const Matrix<OscarNumber>& Equations,
+                     const Vector<OscarNumber>& Objective, bool maximize)
+{
+   OscarNumberLPSolution s = solve_lp(Inequalities, Equations, Objective, maximize);
+   if (s.status == OscarNumberLPStatus::infeasible)
+      throw std::runtime_error("oscarnumber_solve_lp: infeasible");
+   if (s.status == OscarNumberLPStatus::unbounded)
+      throw std::runtime_error("oscarnumber_solve_lp: unbounded");
+   return { s.objective_value, s.solution };
+}
+
+UserFunction4perl("# @category Optimization"
+                  "# Solve a linear program over an oscar field: maximize (or minimize) the objective"
+                  "# over the points x with x_0 = 1, //inequalities// * x >= 0 and //equations// * x = 0."
+                  "# The simplex method runs in floating point first, its final basis is certified in exact"
+                  "# arithmetic and only if this fails the exact simplex continues from there."
+                  "# Throws an exception if the LP is infeasible or unbounded."
+                  "# @param Matrix<OscarNumber> inequalities"
+                  "# @param Matrix<OscarNumber> equations"
+                  "# @param Vector<OscarNumber> objective"
+                  "# @param Bool maximize default: true"
+                  "# @return Pair<OscarNumber, Vector<OscarNumber>> the optimal value and an optimal point",
+                  &oscarnumber_solve_lp,
+                  "oscarnumber_solve_lp(Matrix<OscarNumber>, Matrix<OscarNumber>, Vector<OscarNumber>; $=1)");
+
+} }
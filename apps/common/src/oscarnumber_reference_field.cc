@@ -0,0 +1,640 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#include <julia/julia.h>
+
+#include "polymake/client.h"
+#include "polymake/Rational.h"
+#include "polymake/QuadraticExtension.h"
+#include "polymake/common/oscarnumber_reference_field.h"
+#include "polymake/common/oscarnumber_dispatch_helper.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace polymake { namespace common {
+
+namespace {
+
+// a + b*t + c*t^2 with t the real cube root of r, the values of a cubic reference field;
+// r must be positive and not the cube of a rational, so that t has degree 3
+class cubic_value {
+   public:
+      cubic_value() = default;
+      cubic_value(const Rational& a, const Rational& b, const Rational& c, const Rational& r_) :
+         x{ a, b, c }, r(r_) {}
+
+      const Rational& operator[] (Int i) const { return x[i]; }
+      const Rational& root() const { return r; }
+
+      bool is_zero() const { return pm::is_zero(x[0]) && pm::is_zero(x[1]) && pm::is_zero(x[2]); }
+
+      // t is enclosed in rational intervals, which are bisected until the enclosure of the value
+      // excludes zero; this terminates for a nonzero value, as t is irrational
+      Int sign() const
+      {
+         if (pm::is_zero(x[1]) && pm::is_zero(x[2]))
+            return pm::sign(x[0]);
+         Rational lo(0), hi(1);
+         const double t = std::cbrt(double(r));
+         if (std::isfinite(t)) {
+            lo = Rational(t * (1 - 1e-12));
+            hi = Rational(t * (1 + 1e-12));
+         }
+         if (pm::sign(lo) < 0 || lo * lo * lo > r)
+            lo = 0;
+         while (hi * hi * hi < r)
+            hi *= 2;
+         for (;;) {
+            // all terms are monotone for t >= 0
+            Rational v_lo = x[0], v_hi = x[0];
+            for (Int i = 1; i <= 2; ++i) {
+               const Rational u = x[i] * (i == 1 ? lo : lo * lo), v = x[i] * (i == 1 ? hi : hi * hi);
+               const bool ordered = pm::sign(v - u) >= 0;
+               v_lo += ordered ? u : v;
+               v_hi += ordered ? v : u;
+            }
+            if (pm::sign(v_lo) > 0) return 1;
+            if (pm::sign(v_hi) < 0) return -1;
+            Rational mid = lo + hi;
+            mid /= 2;
+            if (mid * mid * mid < r)
+               lo = std::move(mid);
+            else
+               hi = std::move(mid);
+         }
+      }
+
+      Int compare(const cubic_value& q) const { return (*this - q).sign(); }
+
+      explicit operator double() const
+      {
+         const double t = std::cbrt(double(r));
+         return double(x[0]) + double(x[1]) * t + double(x[2]) * t * t;
+      }
+
+      cubic_value operator- () const { return cubic_value(-x[0], -x[1], -x[2], r); }
+
+      friend cubic_value operator+ (const cubic_value& p, const cubic_value& q)
+      {
+         return cubic_value(p[0] + q[0], p[1] + q[1], p[2] + q[2], p.r);
+      }
+      friend cubic_value operator- (const cubic_value& p, const cubic_value& q)
+      {
+         return cubic_value(p[0] - q[0], p[1] - q[1], p[2] - q[2], p.r);
+      }
+      // with t^3 = r
+      friend cubic_value operator* (const cubic_value& p, const cubic_value& q)
+      {
+         return cubic_value(p[0] * q[0] + p.r * (p[1] * q[2] + p[2] * q[1]),
+                            p[0] * q[1] + p[1] * q[0] + p.r * (p[2] * q[2]),
+                            p[0] * q[2] + p[1] * q[1] + p[2] * q[0], p.r);
+      }
+      friend cubic_value operator/ (const cubic_value& p, const cubic_value& q) { return p * q.inverse(); }
+
+      cubic_value& operator*= (const cubic_value& q) { return *this = *this * q; }
+
+      friend std::ostream& operator<< (std::ostream& os, const cubic_value& p)
+      {
+         return os << p[0] << '+' << p[1] << "*cbrt(" << p.r << ")+" << p[2] << "*cbrt(" << p.r << ")^2";
+      }
+
+   private:
+      // the adjugate of the multiplication by (a, b, c), divided by its norm
+      cubic_value inverse() const
+      {
+         const Rational& a = x[0];
+         const Rational& b = x[1];
+         const Rational& c = x[2];
+         const Rational norm = a * a * a + r * (b * b * b) + r * r * (c * c * c) - 3 * r * (a * b * c);
+         if (pm::is_zero(norm))
+            throw std::domain_error("cubic reference field: division by zero");
+         return cubic_value((a * a - r * (b * c)) / norm, (r * (c * c) - a * b) / norm, (b * b - a * c) / norm, r);
+      }
+
+      Rational x[3];
+      Rational r;
+};
+
+// what the callbacks need to know about the values of a reference field
+struct quadratic_field {
+   typedef QuadraticExtension<Rational> value_type;
+   static constexpr long degree = 2;
+
+   static value_type embed(const Rational& a, const Rational& r) { return value_type(a, Rational(0), r); }
+   static value_type generator(const Rational& r) { return value_type(Rational(0), Rational(1), r); }
+   static value_type from_coeffs(const Rational* c, const Rational& r) { return value_type(c[0], c[1], r); }
+   static value_type one_like(const value_type&) { return value_type(1); }
+   static const Rational& coeff(const value_type& x, long i) { return i ? x.b() : x.a(); }
+
+   static bool is_zero(const value_type& x) { return pm::is_zero(x); }
+   static bool is_one(const value_type& x) { return pm::is_one(x); }
+   static Int sign(const value_type& x) { return pm::sign(x); }
+   static Int compare(const value_type& x, const value_type& y) { return x.compare(y); }
+   static value_type abs(const value_type& x) { return pm::abs(x); }
+   static size_t hash(const value_type& x) { return pm::hash_func<value_type>()(x); }
+
+   // a + b*sqrt(r) evaluated in double precision, widened by a relative error bound
+   // which is generous compared to the few roundings involved
+   static bool enclose(const value_type& x, double* lo_hi)
+   {
+      const double da = double(x.a()), db = double(x.b()), sr = std::sqrt(double(x.r()));
+      return widen(da + db * sr, std::abs(da) + std::abs(db) * sr, lo_hi);
+   }
+
+   static std::string descriptor(const Rational& r)
+   {
+      std::ostringstream os;
+      os << "QuadraticExtension<Rational> sqrt(" << r << ")";
+      return os.str();
+   }
+
+   static bool widen(double v, double magnitude, double* lo_hi)
+   {
+      const double err = 1e-12 * magnitude + std::numeric_limits<double>::denorm_min();
+      if (!std::isfinite(v) || !std::isfinite(err))
+         return false;
+      lo_hi[0] = v - err;
+      lo_hi[1] = v + err;
+      return true;
+   }
+};
+
+struct cubic_field {
+   typedef cubic_value value_type;
+   static constexpr long degree = 3;
+
+   static value_type embed(const Rational& a, const Rational& r) { return value_type(a, Rational(0), Rational(0), r); }
+   static value_type generator(const Rational& r) { return value_type(Rational(0), Rational(1), Rational(0), r); }
+   static value_type from_coeffs(const Rational* c, const Rational& r) { return value_type(c[0], c[1], c[2], r); }
+   static value_type one_like(const value_type& x) { return embed(Rational(1), x.root()); }
+   static const Rational& coeff(const value_type& x, long i) { return x[i]; }
+
+   static bool is_zero(const value_type& x) { return x.is_zero(); }
+   static bool is_one(const value_type& x) { return pm::is_one(x[0]) && pm::is_zero(x[1]) && pm::is_zero(x[2]); }
+   static Int sign(const value_type& x) { return x.sign(); }
+   static Int compare(const value_type& x, const value_type& y) { return x.compare(y); }
+   static value_type abs(const value_type& x) { return x.sign() < 0 ? -x : x; }
+   static size_t hash(const value_type& x)
+   {
+      const pm::hash_func<Rational> h;
+      return h(x[0]) + 31 * (h(x[1]) + 31 * h(x[2]));
+   }
+
+   static bool enclose(const value_type& x, double* lo_hi)
+   {
+      const double da = double(x[0]), db = double(x[1]), dc = double(x[2]), t = std::cbrt(double(x.root()));
+      return quadratic_field::widen(da + db * t + dc * t * t,
+                                    std::abs(da) + std::abs(db) * t + std::abs(dc) * t * t, lo_hi);
+   }
+
+   static std::string descriptor(const Rational& r)
+   {
+      std::ostringstream os;
+      os << "reference cubic field cbrt(" << r << ")";
+      return os.str();
+   }
+};
+
+// all values ever created, elements are boxed indices into the table of their kind of field;
+// the mutex also guards the field data and the protected roots below
+std::mutex values_mutex;
+std::unordered_map<long, Rational> field_roots;
+std::unordered_map<long, std::string> field_descriptors;
+std::unordered_map<long, jl_value_t* (*)(long)> field_generators;
+
+template <typename Field>
+std::deque<typename Field::value_type>& values()
+{
+   static std::deque<typename Field::value_type> v;
+   return v;
+}
+
+// roots of the rooting arenas, kept in a global binding of Main
+jl_array_t* protected_roots = nullptr;
+
+std::atomic<Int> call_cost{0};
+
+// Locks values_mutex; julia may collect while gc_protect holds it, so a thread waiting
+// for it is marked gc-safe, otherwise the collection and the waiting thread would block
+// each other.
+class values_lock {
+   public:
+      values_lock() {
+         if (!values_mutex.try_lock()) {
+            jl_ptls_t ptls = jl_current_task->ptls;
+            int8_t state = jl_gc_safe_enter(ptls);
+            values_mutex.lock();
+            jl_gc_safe_leave(ptls, state);
+         }
+      }
+      ~values_lock() {
+         values_mutex.unlock();
+      }
+
+      values_lock(const values_lock&) = delete;
+      values_lock& operator= (const values_lock&) = delete;
+};
+
+void simulate_call()
+{
+   const Int ns = call_cost;
+   if (ns <= 0) return;
+   const auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+   while (std::chrono::steady_clock::now() < until) ;
+}
+
+template <typename Field>
+const typename Field::value_type& value(jl_value_t* v)
+{
+   values_lock lock;
+   // references into a deque stay valid when it grows
+   return values<Field>()[jl_unbox_int64(v)];
+}
+
+template <typename Field>
+jl_value_t* box(typename Field::value_type&& x)
+{
+   int64_t i;
+   {
+      values_lock lock;
+      i = values<Field>().size();
+      values<Field>().push_back(std::move(x));
+   }
+   return jl_box_int64(i);
+}
+
+const Rational& root_of(long index)
+{
+   values_lock lock;
+   return field_roots.at(index);
+}
+
+Rational rational_from(mpq_srcptr q)
+{
+   Rational r;
+   r.copy_from(q);
+   return r;
+}
+
+Rational rational_from(mpz_srcptr num, mpz_srcptr den)
+{
+   mpq_t q;
+   mpq_init(q);
+   mpz_set(mpq_numref(q), num);
+   mpz_set(mpq_denref(q), den);
+   mpq_canonicalize(q);
+   Rational r = rational_from(q);
+   mpq_clear(q);
+   return r;
+}
+
+// the callbacks, with the signatures expected by oscar_number_dispatch
+
+template <typename Field>
+jl_value_t* init(long index, jl_value_t**, long x)
+{
+   simulate_call();
+   return box<Field>(Field::embed(Rational(x), root_of(index)));
+}
+
+template <typename Field>
+jl_value_t* init_from_mpz(long index, jl_value_t**, const mpz_srcptr num, const mpz_srcptr den)
+{
+   simulate_call();
+   return box<Field>(Field::embed(rational_from(num, den), root_of(index)));
+}
+
+template <typename Field>
+jl_value_t* copy(jl_value_t* a)
+{
+   simulate_call();
+   return box<Field>(typename Field::value_type(value<Field>(a)));
+}
+
+void gc_protect(jl_value_t* v)
+{
+   jl_value_t* r = nullptr;
+   JL_GC_PUSH2(&v, &r);
+   values_lock lock;
+   r = reinterpret_cast<jl_value_t*>(protected_roots);
+   if (!protected_roots) {
+      jl_sym_t* name = jl_symbol("__oscarnumber_reference_roots");
+      r = reinterpret_cast<jl_value_t*>(jl_alloc_vec_any(0));
+      jl_set_global(jl_main_module, name, r);
+      protected_roots = reinterpret_cast<jl_array_t*>(r);
+   }
+   jl_array_ptr_1d_push(protected_roots, v);
+   JL_GC_POP();
+}
+
+void gc_free(jl_value_t*) { }
+
+template <typename Field>
+jl_value_t* add(jl_value_t* a, jl_value_t* b)
+{
+   simulate_call();
+   return box<Field>(value<Field>(a) + value<Field>(b));
+}
+
+template <typename Field>
+jl_value_t* sub(jl_value_t* a, jl_value_t* b)
+{
+   simulate_call();
+   return box<Field>(value<Field>(a) - value<Field>(b));
+}
+
+template <typename Field>
+jl_value_t* mul(jl_value_t* a, jl_value_t* b)
+{
+   simulate_call();
+   return box<Field>(value<Field>(a) * value<Field>(b));
+}
+
+template <typename Field>
+jl_value_t* div(jl_value_t* a, jl_value_t* b)
+{
+   simulate_call();
+   return box<Field>(value<Field>(a) / value<Field>(b));
+}
+
+template <typename Field>
+jl_value_t* pow(jl_value_t* a, long k)
+{
+   typedef typename Field::value_type value_type;
+   simulate_call();
+   const value_type& x = value<Field>(a);
+   value_type base = k < 0 ? Field::one_like(x) / x : x;
+   value_type result = Field::one_like(x);
+   for (unsigned long e = k < 0 ? -static_cast<unsigned long>(k) : k; e; e >>= 1) {
+      if (e & 1) result *= base;
+      if (e > 1) base *= value_type(base);
+   }
+   return box<Field>(std::move(result));
+}
+
+template <typename Field>
+jl_value_t* negate(jl_value_t* a)
+{
+   simulate_call();
+   return box<Field>(-value<Field>(a));
+}
+
+template <typename Field>
+long cmp(jl_value_t* a, jl_value_t* b)
+{
+   simulate_call();
+   return Field::compare(value<Field>(a), value<Field>(b));
+}
+
+template <typename Field>
+char* to_string(jl_value_t* a)
+{
+   simulate_call();
+   static thread_local std::string buffer;
+   std::ostringstream os;
+   os << value<Field>(a);
+   buffer = os.str();
+   return &buffer[0];
+}
+
+template <typename Field>
+bool is_zero(jl_value_t* a)
+{
+   simulate_call();
+   return Field::is_zero(value<Field>(a));
+}
+
+template <typename Field>
+bool is_one(jl_value_t* a)
+{
+   simulate_call();
+   return Field::is_one(value<Field>(a));
+}
+
+template <typename Field>
+long sign(jl_value_t* a)
+{
+   simulate_call();
+   return Field::sign(value<Field>(a));
+}
+
+template <typename Field>
+jl_value_t* abs(jl_value_t* a)
+{
+   simulate_call();
+   return box<Field>(Field::abs(value<Field>(a)));
+}
+
+template <typename Field>
+size_t hash(jl_value_t* a)
+{
+   simulate_call();
+   return Field::hash(value<Field>(a));
+}
+
+template <typename Field>
+bool rational_value(const typename Field::value_type& x)
+{
+   for (long i = 1; i < Field::degree; ++i)
+      if (!pm::is_zero(Field::coeff(x, i)))
+         return false;
+   return true;
+}
+
+template <typename Field>
+mpq_ptr to_rational(jl_value_t* a)
+{
+   simulate_call();
+   const typename Field::value_type& x = value<Field>(a);
+   if (!rational_value<Field>(x))
+      return nullptr;
+   static thread_local Rational buffer;
+   buffer = Field::coeff(x, 0);
+   return const_cast<mpq_ptr>(buffer.get_rep());
+}
+
+template <typename Field>
+bool is_rational(jl_value_t* a)
+{
+   simulate_call();
+   return rational_value<Field>(value<Field>(a));
+}
+
+template <typename Field>
+double to_float(jl_value_t* a)
+{
+   simulate_call();
+   return double(value<Field>(a));
+}
+
+template <typename Field>
+jl_value_t* addmul(jl_value_t* x, jl_value_t* a, jl_value_t* b)
+{
+   simulate_call();
+   return box<Field>(value<Field>(x) + value<Field>(a) * value<Field>(b));
+}
+
+template <typename Field>
+jl_value_t* submul(jl_value_t* x, jl_value_t* a, jl_value_t* b)
+{
+   simulate_call();
+   return box<Field>(value<Field>(x) - value<Field>(a) * value<Field>(b));
+}
+
+template <typename Field>
+jl_value_t* cross_diff_div(jl_value_t* a, jl_value_t* b, jl_value_t* c, jl_value_t* d, jl_value_t* p)
+{
+   simulate_call();
+   return box<Field>((value<Field>(a) * value<Field>(b) - value<Field>(c) * value<Field>(d)) / value<Field>(p));
+}
+
+template <typename Field>
+bool enclose(jl_value_t* a, double* lo_hi)
+{
+   simulate_call();
+   return Field::enclose(value<Field>(a), lo_hi);
+}
+
+template <typename Field>
+long coeffs(jl_value_t* a, mpq_ptr* out, long n)
+{
+   simulate_call();
+   const typename Field::value_type& x = value<Field>(a);
+   for (long i = 0; i < n && i < Field::degree; ++i)
+      mpq_set(out[i], Field::coeff(x, i).get_rep());
+   return Field::degree;
+}
+
+template <typename Field>
+jl_value_t* from_coeffs(long index, const mpq_srcptr* c, long n)
+{
+   simulate_call();
+   Rational r[Field::degree];
+   for (long i = 0; i < n && i < Field::degree; ++i)
+      r[i] = rational_from(c[i]);
+   return box<Field>(Field::from_coeffs(r, root_of(index)));
+}
+
+char* descriptor(long index)
+{
+   values_lock lock;
+   return &field_descriptors.at(index)[0];
+}
+
+template <typename Field>
+jl_value_t* generator(long index)
+{
+   return box<Field>(Field::generator(root_of(index)));
+}
+
+template <typename Fptr>
+void* callback(Fptr f)
+{
+   return reinterpret_cast<void*>(f);
+}
+
+template <typename Field>
+void register_field(long index, const Rational& root, Int call_cost_ns, bool native)
+{
+   {
+      values_lock lock;
+      field_roots[index] = root;
+      field_descriptors[index] = Field::descriptor(root);
+      field_generators[index] = &generator<Field>;
+   }
+   call_cost = call_cost_ns;
+
+   // all other entries stay null, which exercises the generic fallbacks
+   juliainterface::oscar_number_dispatch_helper helper{};
+   helper.index         = index;
+   helper.init          = callback(&init<Field>);
+   helper.init_from_mpz = callback(&init_from_mpz<Field>);
+   helper.copy          = callback(&copy<Field>);
+   helper.gc_protect    = callback(&gc_protect);
+   helper.gc_free       = callback(&gc_free);
+   helper.add           = callback(&add<Field>);
+   helper.sub           = callback(&sub<Field>);
+   helper.mul           = callback(&mul<Field>);
+   helper.div           = callback(&div<Field>);
+   helper.pow           = callback(&pow<Field>);
+   helper.negate        = callback(&negate<Field>);
+   helper.cmp           = callback(&cmp<Field>);
+   helper.to_string     = callback(&to_string<Field>);
+   helper.is_zero       = callback(&is_zero<Field>);
+   helper.is_one        = callback(&is_one<Field>);
+   helper.sign          = callback(&sign<Field>);
+   helper.abs           = callback(&abs<Field>);
+   helper.hash          = callback(&hash<Field>);
+   helper.to_rational   = callback(&to_rational<Field>);
+   helper.to_float      = callback(&to_float<Field>);
+   helper.addmul        = callback(&addmul<Field>);
+   helper.submul        = callback(&submul<Field>);
+   helper.enclose       = callback(&enclose<Field>);
+   helper.coeffs        = callback(&coeffs<Field>);
+   helper.from_coeffs   = callback(&from_coeffs<Field>);
+   helper.descriptor    = callback(&descriptor);
+   helper.is_rational   = callback(&is_rational<Field>);
+   helper.cross_diff_div = callback(&cross_diff_div<Field>);
+   if (native)
+      helper.quadratic_root = const_cast<mpq_ptr>(root.get_rep());
+   OscarNumber::register_oscar_number(&helper, index, sizeof(helper));
+}
+
+}
+
+void register_reference_field(long index, const Rational& root, Int call_cost_ns, bool native)
+{
+   register_field<quadratic_field>(index, root, call_cost_ns, native);
+}
+
+void register_cubic_reference_field(long index, const Rational& root, Int call_cost_ns)
+{
+   if (pm::sign(root) <= 0)
+      throw std::runtime_error("register_cubic_reference_field: the root must be positive");
+   register_field<cubic_field>(index, root, call_cost_ns, false);
+}
+
+void set_reference_field_call_cost(Int call_cost_ns)
+{
+   call_cost = call_cost_ns;
+}
+
+OscarNumber reference_field_generator(long index)
+{
+   // throws for an unknown field, nothing may throw inside the gc frame below
+   OscarNumber::field_descriptor(index);
+   jl_value_t* (*make_generator)(long);
+   {
+      values_lock lock;
+      make_generator = field_generators.at(index);
+   }
+   jl_value_t* v = make_generator(index);
+   OscarNumber x;
+   JL_GC_PUSH1(&v);
+   OscarNumber::from_julia(reinterpret_cast<void* const*>(&v), 1, index, &x);
+   JL_GC_POP();
+   return x;
+}
+
+} }
@@ -0,0 +1,104 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef POLYMAKE_POLYTOPE_OSCARNUMBER_LP_SOLVER_H
+#define POLYMAKE_POLYTOPE_OSCARNUMBER_LP_SOLVER_H
+
+#include "polymake/Matrix.h"
+#include "polymake/Vector.h"
+#include "polymake/polytope/solve_LP.h"
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_linalg.h"
+#include "polymake/common/oscarnumber_lp.h"
+
+#include <type_traits>
+
+namespace polymake { namespace polytope { namespace oscarnumber_interface {
+
+using common::OscarNumber;
+
+// LP solver for OscarNumber, see common::solve_lp: the simplex runs in floating point
+// and its final basis is certified in exact arithmetic, so that the clients of the
+// LP solver (H_input_feasible, H_input_bounded, rel_int_point, lineality_via_lp, ...)
+// only pivot in the oscar field if the certification fails.
+// LPs whose entries are all rational are converted and handed to the LP solver for Rational,
+// together with accept_non_feasible, and its solution is converted back.
+// Otherwise infeasible and unbounded LPs are always told apart and reported by their status,
+// so accept_non_feasible makes no difference, and lineality_dim is not computed and left at -1.
+class Solver : public LP_Solver<OscarNumber> {
+   public:
+      LP_Solution<OscarNumber>
+      solve(const Matrix<OscarNumber>& inequalities, const Matrix<OscarNumber>& equations,
+            const Vector<OscarNumber>& objective, bool maximize, bool accept_non_feasible) const override
+      {
+         if (common::oscarnumber_linalg::uses_rational(objective) &&
+             common::oscarnumber_linalg::uses_rational(inequalities) &&
+             common::oscarnumber_linalg::uses_rational(equations))
+            return solve_rational(inequalities, equations, objective, maximize, accept_non_feasible);
+
+         common::OscarNumberLPSolution s = common::solve_lp(inequalities, equations, objective, maximize);
+         LP_Solution<OscarNumber> result;
+         switch (s.status) {
+         case common::OscarNumberLPStatus::valid:
+            result.status = LP_status::valid;
+            result.objective_value = std::move(s.objective_value);
+            result.solution = std::move(s.solution);
+            break;
+         case common::OscarNumberLPStatus::infeasible:
+            result.status = LP_status::infeasible;
+            break;
+         case common::OscarNumberLPStatus::unbounded:
+            result.status = LP_status::unbounded;
+            break;
+         }
+         return result;
+      }
+
+   private:
+      static LP_Solution<OscarNumber>
+      solve_rational(const Matrix<OscarNumber>& inequalities, const Matrix<OscarNumber>& equations,
+                     const Vector<OscarNumber>& objective, bool maximize, bool accept_non_feasible)
+      {
+         LP_Solution<Rational> s = get_LP_solver<Rational>().solve(Matrix<Rational>(inequalities), Matrix<Rational>(equations),
+                                                                   Vector<Rational>(objective), maximize, accept_non_feasible);
+         LP_Solution<OscarNumber> result;
+         result.status = s.status;
+         result.lineality_dim = s.lineality_dim;
+         if (s.status == LP_status::valid) {
+            result.objective_value = OscarNumber(s.objective_value);
+            result.solution = Vector<OscarNumber>(s.solution);
+         }
+         return result;
+      }
+};
+
+template <typename Scalar>
+auto create_LP_solver()
+{
+   static_assert(std::is_same<Scalar, OscarNumber>::value, "the oscarnumber LP solver only works with OscarNumber");
+   return cached_LP_solver<Scalar>(new Solver(), true);
+}
+
+} } }
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
@@ -0,0 +1,26 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+#include "polymake/client.h"
+#include "polymake/polytope/oscarnumber_lp_solver.h"
+
+namespace polymake { namespace polytope {
+
+InsertEmbeddedRule("function oscarnumber.simplex: create_LP_solver<Scalar> [Scalar==OscarNumber] () "
+                   ": c++ (name => 'oscarnumber_interface::create_LP_solver') : returns(cached);\n");
+
+} }
@@ -0,0 +1,59 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+// Helpers shared by the OscarNumber benchmarks.
+
+#ifndef POLYMAKE_OSCARNUMBER_BENCH_H
+#define POLYMAKE_OSCARNUMBER_BENCH_H
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/Matrix.h"
+
+#include <random>
+#include <vector>
+
+namespace polymake { namespace common {
+
+// dim x dim matrix over the field of the generator g of the given degree, the entries
+// are combinations of 1, g, ..., g^(degree-1) with random integer coefficients in [-9, 9]
+inline
+Matrix<OscarNumber> random_matrix(Int dim, const OscarNumber& g, Int degree, std::mt19937& rng)
+{
+   std::uniform_int_distribution<long> coeff(-9, 9);
+   std::vector<OscarNumber> basis{ OscarNumber(1) };
+   for (Int k = 1; k < degree; ++k)
+      basis.push_back(basis.back() * g);
+   Matrix<OscarNumber> M(dim, dim);
+   for (Int i = 0; i < dim; ++i)
+      for (Int j = 0; j < dim; ++j) {
+         OscarNumber x(Rational(coeff(rng)));
+         for (Int k = 1; k < degree; ++k)
+            x += basis[k] * Rational(coeff(rng));
+         M(i, j) = x;
+      }
+   return M;
+}
+
+} }
+
+#endif
+
+// Local Variables:
+// mode:C++
+// c-basic-offset:3
+// indent-tabs-mode:nil
+// End:
@@ -0,0 +1,93 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+// Cost of single OscarNumber operations: rationals, the reference field Q(sqrt(2))
+// computed natively, and the same field through the callbacks without any simulated
+// call cost, so that the last column is the overhead of the OscarNumber layer itself.
+//
+//   oscarnumber_calls [iterations]
+
+#include <julia/julia.h>
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_reference_field.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace polymake;
+using namespace polymake::common;
+
+namespace {
+
+// nanoseconds per call of f
+template <typename F>
+double ns_per_op(Int iterations, F&& f)
+{
+   const auto start = std::chrono::steady_clock::now();
+   for (Int i = 0; i < iterations; ++i)
+      f();
+   return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+struct operands {
+   OscarNumber a, b, c;
+};
+
+// one line of the table, op(x, a, b) is timed on the operands of each column
+template <typename Op>
+void row(const char* name, Int iterations, const operands* ops, Op op)
+{
+   std::printf("%-10s", name);
+   for (Int k = 0; k < 3; ++k) {
+      OscarNumber x = ops[k].c;
+      std::printf(" %12.1f", ns_per_op(iterations, [&]() { op(x, ops[k].a, ops[k].b); }));
+   }
+   std::printf("\n");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   const Int iterations = argc > 1 ? std::atol(argv[1]) : 100000;
+
+   jl_init();
+   {
+      register_reference_field(1, Rational(2));
+      register_reference_field(2, Rational(2), 0, true);
+      const OscarNumber g1 = reference_field_generator(1);
+      const OscarNumber g2 = reference_field_generator(2);
+      const operands ops[3] = {
+         { OscarNumber(Rational(3, 7)), OscarNumber(Rational(-5, 11)), OscarNumber(1) },
+         { g2 + Rational(3, 7), g2 * Rational(-5, 11) + 1, OscarNumber(1) + g2 },
+         { g1 + Rational(3, 7), g1 * Rational(-5, 11) + 1, OscarNumber(1) + g1 },
+      };
+      std::printf("ns per operation, %ld iterations\n", long(iterations));
+      std::printf("%-10s %12s %12s %12s\n", "", "rational", "native", "callbacks");
+      row("copy", iterations, ops, [](OscarNumber& x, const OscarNumber& a, const OscarNumber&) { x = OscarNumber(a); });
+      row("add", iterations, ops, [](OscarNumber& x, const OscarNumber& a, const OscarNumber&) { x += a; });
+      row("mul", iterations, ops, [](OscarNumber& x, const OscarNumber& a, const OscarNumber& b) { x = a * b; });
+      row("add_mul", iterations, ops, [](OscarNumber& x, const OscarNumber& a, const OscarNumber& b) { x.add_mul(a, b); });
+      row("cmp", iterations, ops, [](OscarNumber& x, const OscarNumber& a, const OscarNumber& b) { x = a.cmp(b); });
+      row("sign", iterations, ops, [](OscarNumber& x, const OscarNumber& a, const OscarNumber&) { x = a.sign(); });
+   }
+   oscarnumber_prepare_cleanup();
+   jl_atexit_hook(0);
+   return 0;
+}
@@ -0,0 +1,120 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+// Determinants over the quadratic reference field Q(sqrt(2)) and the cubic one Q(cbrt(2)):
+// the generic field elimination of polymake/linalg.h, which the det wrapper instantiated for
+// OscarNumber before oscarnumber_linalg and which divides once per entry update, against the
+// fraction-free elimination of oscarnumber_linalg::det and the fraction-free LU decomposition.
+//
+//   oscarnumber_elimination [dim [call_cost_ns]]
+//
+// For the quadratic field with callbacks (using the fused cross_diff_div), the native
+// quadratic field and the cubic field with callbacks the wall clock time and the number of
+// julia callbacks of each variant are printed.
+
+#include <julia/julia.h>
+
+#include "polymake/linalg.h"
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_linalg.h"
+#include "polymake/common/oscarnumber_reference_field.h"
+#include "oscarnumber_bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace polymake;
+using namespace polymake::common;
+
+namespace {
+
+struct bench_field {
+   long index;
+   const char* name;
+   Int degree;
+};
+
+// The generic elimination: pm::det(Matrix<E>) takes the matrix by value and is thus a better
+// match for a Matrix<OscarNumber> than the overloads for GenericMatrix, including the one of
+// oscarnumber_linalg.h which the wrappers of the extension reach.
+OscarNumber generic_det(const Matrix<OscarNumber>& M)
+{
+   return pm::det(Matrix<OscarNumber>(M));
+}
+
+// julia callbacks made since the last reset, without the events and the public operations
+Int callback_calls(long index)
+{
+   Int calls = 0;
+   for (const OscarNumberCallStats& s : OscarNumber::call_stats(index)) {
+      if (s.name.compare(0, 13, "OscarNumber::") == 0 || s.name == "upgrade" ||
+          s.name == "demotion" || s.name == "shared_write")
+         continue;
+      calls += s.calls;
+   }
+   return calls;
+}
+
+template <typename F>
+void measure(const bench_field& field, const char* name, F&& f)
+{
+   OscarNumber::reset_call_stats(field.index);
+   const auto start = std::chrono::steady_clock::now();
+   f();
+   const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+   std::printf("%-20s %-10s %12.1f %12ld\n", field.name, name, ms, long(callback_calls(field.index)));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   const Int dim = argc > 1 ? std::atol(argv[1]) : 40;
+   const Int call_cost = argc > 2 ? std::atol(argv[2]) : 200;
+
+   jl_init();
+   {
+      register_reference_field(1, Rational(2), call_cost);
+      register_reference_field(2, Rational(2), call_cost, true);
+      register_cubic_reference_field(3, Rational(2), call_cost);
+      set_oscarnumber_threads(1);
+      OscarNumber::set_instrumentation(true);
+
+      const bench_field fields[] = {
+         { 1, "sqrt(2) callbacks", 2 },
+         { 2, "sqrt(2) native", 2 },
+         { 3, "cbrt(2) callbacks", 3 }
+      };
+      std::printf("dim %ld, simulated call cost %ld ns, one thread\n", long(dim), long(call_cost));
+      std::printf("%-20s %-10s %12s %12s\n", "field", "det", "ms", "callbacks");
+      for (const bench_field& field : fields) {
+         std::mt19937 rng(1);
+         const Matrix<OscarNumber> M = random_matrix(dim, reference_field_generator(field.index), field.degree, rng);
+         OscarNumber d_generic, d_bareiss, d_lu;
+         measure(field, "generic", [&]() { d_generic = generic_det(M); });
+         measure(field, "bareiss", [&]() { d_bareiss = oscarnumber_linalg::det(M); });
+         measure(field, "ff-lu", [&]() { d_lu = oscarnumber_linalg::fraction_free_lu(M).U(dim-1, dim-1); });
+         // the LU determinant is the one of the permuted rows
+         if (d_generic != d_bareiss || abs(d_lu) != abs(d_bareiss))
+            std::printf("different determinants for %s\n", field.name);
+      }
+   }
+   oscarnumber_prepare_cleanup();
+   jl_atexit_hook(0);
+   return 0;
+}
@@ -0,0 +1,86 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+// Scaling of the parallel elimination kernels with the number of OscarNumber threads,
+// on random matrices over the reference field Q(sqrt(2)).
+//
+//   oscarnumber_threads [dim [call_cost_ns [max_threads]]]
+//
+// For each thread count 1, 2, 4, ... up to max_threads the wall clock time of det and
+// rank is printed together with the speedup over a single thread.  A simulated call
+// cost of a few hundred nanoseconds resembles the arithmetic of small number fields
+// in Oscar.
+
+#include <julia/julia.h>
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_linalg.h"
+#include "polymake/common/oscarnumber_reference_field.h"
+#include "oscarnumber_bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+using namespace polymake;
+using namespace polymake::common;
+
+namespace {
+
+template <typename F>
+double milliseconds(F&& f)
+{
+   const auto start = std::chrono::steady_clock::now();
+   f();
+   return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   const Int dim = argc > 1 ? std::atol(argv[1]) : 60;
+   const Int call_cost = argc > 2 ? std::atol(argv[2]) : 200;
+   const Int max_threads = argc > 3 ? std::atol(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+
+   jl_init();
+   {
+      register_reference_field(1, Rational(2), call_cost);
+      std::mt19937 rng(1);
+      const Matrix<OscarNumber> M = random_matrix(dim, reference_field_generator(1), 2, rng);
+
+      std::printf("dim %ld, simulated call cost %ld ns\n", long(dim), long(call_cost));
+      std::printf("%8s %12s %8s %12s %8s\n", "threads", "det ms", "speedup", "rank ms", "speedup");
+      double det_serial = 0, rank_serial = 0;
+      for (Int t = 1; t <= max_threads; t *= 2) {
+         set_oscarnumber_threads(t);
+         const double det_ms = milliseconds([&]() { oscarnumber_linalg::det(M); });
+         const double rank_ms = milliseconds([&]() { oscarnumber_linalg::rank(M); });
+         if (t == 1) {
+            det_serial = det_ms;
+            rank_serial = rank_ms;
+         }
+         std::printf("%8ld %12.1f %8.2f %12.1f %8.2f\n", long(t),
+                     det_ms, det_serial / det_ms, rank_ms, rank_serial / rank_ms);
+      }
+   }
+   oscarnumber_prepare_cleanup();
+   jl_atexit_hook(0);
+   return 0;
+}
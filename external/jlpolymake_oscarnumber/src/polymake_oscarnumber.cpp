@@ -10,10 +10,15 @@
 
 #include <jlpolymake/containers.h>
 
+#include <jlcxx/tuple.hpp>
+
 #include <polymake/common/OscarNumber.h>
+#include <polymake/common/oscarnumber_binary.h>
 
 #include <cxxabi.h>
 #include <typeinfo>
+#include <unordered_map>
+#include <vector>
 
 
 namespace jlpolymake {
@@ -70,30 +75,124 @@ jl_value_t* POLYMAKETYPE_Matrix_OscarNumber;
 jl_value_t* POLYMAKETYPE_SparseVector_OscarNumber;
 jl_value_t* POLYMAKETYPE_SparseMatrix_OscarNumber;
 
+// the polymake types which are fed by this module, resolved once for each julia type
+enum class oscarnumber_arg : unsigned char {
+   none, scalar, array, vector, matrix, sparse_vector, sparse_matrix
+};
+
+oscarnumber_arg resolve_oscarnumber_type(jl_value_t* type)
+{
+   if (jl_subtype(type, POLYMAKETYPE_OscarNumber))
+      return oscarnumber_arg::scalar;
+   if (jl_subtype(type, POLYMAKETYPE_Array_OscarNumber))
+      return oscarnumber_arg::array;
+   if (jl_subtype(type, POLYMAKETYPE_Vector_OscarNumber))
+      return oscarnumber_arg::vector;
+   if (jl_subtype(type, POLYMAKETYPE_Matrix_OscarNumber))
+      return oscarnumber_arg::matrix;
+   if (jl_subtype(type, POLYMAKETYPE_SparseVector_OscarNumber))
+      return oscarnumber_arg::sparse_vector;
+   if (jl_subtype(type, POLYMAKETYPE_SparseMatrix_OscarNumber))
+      return oscarnumber_arg::sparse_matrix;
+   return oscarnumber_arg::none;
+}
+
+// the feeders are called for every argument of every polymake call, also for
+// arguments of other types, so the subtype checks are only done for the first
+// value of each concrete type; datatypes are never freed by julia.
+// The cache is per thread to avoid locking.
+oscarnumber_arg oscarnumber_type_of(jl_value_t* value)
+{
+   static thread_local std::unordered_map<jl_value_t*, oscarnumber_arg> cache;
+   static thread_local jl_value_t* last_type = nullptr;
+   static thread_local oscarnumber_arg last_arg = oscarnumber_arg::none;
+
+   jl_value_t* type = jl_typeof(value);
+   if (type == last_type)
+      return last_arg;
+   auto it = cache.find(type);
+   if (it == cache.end())
+      it = cache.emplace(type, resolve_oscarnumber_type(type)).first;
+   last_type = type;
+   last_arg = it->second;
+   return last_arg;
+}
+
 template <typename FunType>
-bool feed_oscarnumber_types(FunType&& fc, jl_value_t* value)
+bool feed_oscarnumber_arg(FunType&& fc, oscarnumber_arg arg, jl_value_t* value)
 {
-   jl_value_t* current_type = jl_typeof(value);
-   if (jl_subtype(current_type, POLYMAKETYPE_OscarNumber)) {
+   switch (arg) {
+   case oscarnumber_arg::scalar:
       fc << jlcxx::unbox<const polymake::common::OscarNumber&>(value);
       return true;
-   } else if (jl_subtype(current_type, POLYMAKETYPE_Array_OscarNumber)) {
+   case oscarnumber_arg::array:
       fc << jlcxx::unbox<const pm::Array<polymake::common::OscarNumber>&>(value);
       return true;
-   } else if (jl_subtype(current_type, POLYMAKETYPE_Vector_OscarNumber)) {
+   case oscarnumber_arg::vector:
       fc << jlcxx::unbox<const pm::Vector<polymake::common::OscarNumber>&>(value);
       return true;
-   } else if (jl_subtype(current_type, POLYMAKETYPE_Matrix_OscarNumber)) {
+   case oscarnumber_arg::matrix:
       fc << jlcxx::unbox<const pm::Matrix<polymake::common::OscarNumber>&>(value);
       return true;
-   } else if (jl_subtype(current_type, POLYMAKETYPE_SparseVector_OscarNumber)) {
+   case oscarnumber_arg::sparse_vector:
       fc << jlcxx::unbox<const pm::SparseVector<polymake::common::OscarNumber>&>(value);
       return true;
-   } else if (jl_subtype(current_type, POLYMAKETYPE_SparseMatrix_OscarNumber)) {
+   case oscarnumber_arg::sparse_matrix:
       fc << jlcxx::unbox<const pm::SparseMatrix<polymake::common::OscarNumber>&>(value);
       return true;
+   default:
+      return false;
    }
-   return false;
+}
+
+template <typename FunType>
+bool feed_oscarnumber_types(FunType&& fc, jl_value_t* value)
+{
+   return feed_oscarnumber_arg(std::forward<FunType>(fc), oscarnumber_type_of(value), value);
+}
+
+// argument types of the last call of _call_function_oscarnumber in this thread:
+// repeated calls with the same types, like a loop over many small queries, feed
+// their arguments without resolving any type
+struct oscarnumber_signature {
+   std::vector<jl_value_t*> types;
+   std::vector<oscarnumber_arg> args;
+
+   bool matches(const jlcxx::ArrayRef<jl_value_t*>& arguments) const
+   {
+      if (types.size() != arguments.size())
+         return false;
+      for (size_t i = 0; i < types.size(); ++i)
+         if (jl_typeof(arguments[i]) != types[i])
+            return false;
+      return true;
+   }
+
+   void assign(const jlcxx::ArrayRef<jl_value_t*>& arguments)
+   {
+      types.resize(arguments.size());
+      args.resize(arguments.size());
+      for (size_t i = 0; i < types.size(); ++i) {
+         types[i] = jl_typeof(arguments[i]);
+         args[i] = oscarnumber_type_of(arguments[i]);
+      }
+   }
+};
+
+pm::perl::PropertyValue call_function_oscarnumber(const std::string& function_name,
+                                                  const jlcxx::ArrayRef<jl_value_t*>& arguments)
+{
+   static thread_local oscarnumber_signature signature;
+   if (!signature.matches(arguments))
+      signature.assign(arguments);
+
+   auto function = polymake::prepare_call_function(function_name);
+   for (size_t i = 0; i < signature.args.size(); ++i) {
+      // arguments of other types go through all registered feeders
+      if (!feed_oscarnumber_arg(function, signature.args[i], arguments[i]))
+         call_function_feed_argument(function, arguments[i]);
+   }
+   return function();
 }
 
 void add_oscarnumber(jlcxx::Module& jlmodule)
@@ -157,6 +256,108 @@ void add_oscarnumber(jlcxx::Module& jlmodule)
     jlmodule.method("_register_oscar_number", [](void* dispatch, long index) {
         polymake::common::OscarNumber::register_oscar_number(dispatch, index);
     });
+
+    // the table of the julia side with its size, see oscarnumber_dispatch_helper.h
+    jlmodule.method("_register_oscar_number", [](void* dispatch, long index, size_t helper_size) {
+        polymake::common::OscarNumber::register_oscar_number(dispatch, index, helper_size);
+    });
+
+    jlmodule.method("_constant_cache_stats", [](long index) {
+        const polymake::common::OscarNumberCacheStats stats =
+           polymake::common::OscarNumber::constant_cache_stats(index);
+        return std::make_tuple(stats.small_hits, stats.lru_hits, stats.misses, stats.evictions);
+    });
+
+    jlmodule.method("_filter_stats", [](long index) {
+        const polymake::common::OscarNumberFilterStats stats =
+           polymake::common::OscarNumber::filter_stats(index);
+        return std::make_tuple(stats.decided, stats.undecided, stats.enclosures);
+    });
+
+    jlmodule.method("_set_instrumentation", [](bool enable) {
+        polymake::common::OscarNumber::set_instrumentation(enable);
+    });
+
+    jlmodule.method("_instrumentation", []() {
+        return polymake::common::OscarNumber::instrumentation();
+    });
+
+    // number of entries of _call_stats, the same for all fields
+    jlmodule.method("_call_stats_length", [](long index) {
+        return long(polymake::common::OscarNumber::call_stats(index).size());
+    });
+
+    // name, calls and total nanoseconds of entry i (1-based) of the instrumentation,
+    // callbacks, events and the public operations "OscarNumber::..."
+    jlmodule.method("_call_stats", [](long index, long i) {
+        const std::vector<polymake::common::OscarNumberCallStats> stats =
+           polymake::common::OscarNumber::call_stats(index);
+        if (i < 1 || i > long(stats.size()))
+            throw std::out_of_range("_call_stats: index out of range");
+        const polymake::common::OscarNumberCallStats& s = stats[i-1];
+        return std::make_tuple(s.name, s.calls, s.ns);
+    });
+
+    jlmodule.method("_reset_call_stats", [](long index) {
+        polymake::common::OscarNumber::reset_call_stats(index);
+    });
+
+    // bulk exchange of the entries of julia arrays, elems is the column-major
+    // Vector{Any} of the entries (vec(A) of a matrix A), the elements are shared
+    jlmodule.method("_matrix_from_julia", [](jl_value_t* elems, long rows, long cols, long index) {
+        if (rows < 0 || cols < 0 || !jl_is_array(elems) ||
+            jl_array_len(reinterpret_cast<jl_array_t*>(elems)) != size_t(rows * cols))
+            throw std::runtime_error("_matrix_from_julia: dimension mismatch");
+        std::vector<void*> ptrs(rows * cols);
+        for (long i = 0; i < rows; ++i)
+            for (long j = 0; j < cols; ++j)
+                ptrs[i * cols + j] = jl_array_ptr_ref(elems, j * rows + i);
+        pm::Matrix<polymake::common::OscarNumber> M(rows, cols);
+        if (rows * cols)
+            polymake::common::OscarNumber::from_julia(ptrs.data(), rows * cols, index, &M(0, 0));
+        return M;
+    });
+
+    jlmodule.method("_vector_from_julia", [](jl_value_t* elems, long index) {
+        if (!jl_is_array(elems))
+            throw std::runtime_error("_vector_from_julia: not an array");
+        const long n = jl_array_len(reinterpret_cast<jl_array_t*>(elems));
+        std::vector<void*> ptrs(n);
+        for (long i = 0; i < n; ++i)
+            ptrs[i] = jl_array_ptr_ref(elems, i);
+        pm::Vector<polymake::common::OscarNumber> v(n);
+        if (n)
+            polymake::common::OscarNumber::from_julia(ptrs.data(), n, index, &v[0]);
+        return v;
+    });
+
+    // the entries as a column-major Vector{Any}, to be reshaped to rows x cols in julia
+    jlmodule.method("_matrix_to_julia", [](const pm::Matrix<polymake::common::OscarNumber>& M, long index) {
+        const long rows = M.rows(), cols = M.cols();
+        std::vector<const polymake::common::OscarNumber*> ptrs(rows * cols);
+        for (long i = 0; i < rows; ++i)
+            for (long j = 0; j < cols; ++j)
+                ptrs[j * rows + i] = &M(i, j);
+        return reinterpret_cast<jl_value_t*>(
+           polymake::common::OscarNumber::to_julia(ptrs.data(), rows * cols, index));
+    });
+
+    jlmodule.method("_write_binary", [](const std::string& filename, const pm::Matrix<polymake::common::OscarNumber>& M) {
+        polymake::common::write_binary(filename, M);
+    });
+
+    jlmodule.method("_read_binary", [](const std::string& filename, long index) {
+        return polymake::common::read_binary(filename, index);
+    });
+
+    jlmodule.method("_vector_to_julia", [](const pm::Vector<polymake::common::OscarNumber>& v, long index) {
+        const long n = v.dim();
+        std::vector<const polymake::common::OscarNumber*> ptrs(n);
+        for (long i = 0; i < n; ++i)
+            ptrs[i] = &v[i];
+        return reinterpret_cast<jl_value_t*>(
+           polymake::common::OscarNumber::to_julia(ptrs.data(), n, index));
+    });
 }
 
 
@@ -191,8 +392,15 @@ JLCXX_MODULE define_module_polymake_oscarnumber(jlcxx::Module& jlmodule)
 
     jlmodule.method("get_type_names_oscarnumber", &get_type_names_oscarnumber);
 
+    // polymake function call like call_function, for calls with OscarNumber arguments
+    // repeated many times with the same argument types
+    jlmodule.method("_call_function_oscarnumber", &call_function_oscarnumber);
+
     jlmodule.method("oscarnumber_prepare_cleanup", []() { polymake::common::oscarnumber_prepare_cleanup(); });
 
+    jlmodule.method("oscarnumber_threads", []() { return polymake::common::oscarnumber_threads(); });
+    jlmodule.method("set_oscarnumber_threads", [](long n) { polymake::common::set_oscarnumber_threads(n); });
+
     insert_type_in_map("OscarNumber", &POLYMAKETYPE_OscarNumber);
     insert_type_in_map("Array_OscarNumber", &POLYMAKETYPE_Array_OscarNumber);
     insert_type_in_map("Vector_OscarNumber", &POLYMAKETYPE_Vector_OscarNumber);
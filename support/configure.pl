@@ -35,6 +35,9 @@ sub proceed {
    my ($options)=@_;
    my ($julia_path, $julia_version, $julia_inc, $julia_lib, $julia_config);
    my ($cxxwrap_path, $cxxwrap_version, $cxxwrap_inc, $cxxwrap_lib, $cxxwrap_config);
+   # OpenMP threads of the core templates instantiated here would enter julia without
+   # being adopted, which is impossible before julia 1.9; the OscarNumber kernels use
+   # their own pool of adopted threads instead, see oscarnumber_parallel_for
    $CXXFLAGS = "-fno-openmp";
 
    if (defined ($cxxwrap_path=$options->{cxxwrap})) {
@@ -43,14 +46,14 @@ sub proceed {
    }
    if ($cxxwrap_inc) {
       if (-f "$cxxwrap_inc/jlcxx/jlcxx.hpp") {
-         $CXXFLAGS .= "-I$cxxwrap_inc/jlcxx";
+         $CXXFLAGS .= " -I$cxxwrap_inc/jlcxx";
       } else {
          die "Invalid installation location of cxxwrap: header file $cxxwrap_inc/cxxwrap/cxxwrap.h does not exist\n";
       }
    }
    if ($cxxwrap_lib) {
       if (-f "$cxxwrap_lib/libcxxwrap_julia.$Config::Config{so}") {
-         $LDFLAGS .= "-L$cxxwrap_lib";
+         $LDFLAGS .= " -L$cxxwrap_lib";
          $LDFLAGS .= " -Wl,-rpath,$cxxwrap_lib" unless $cxxwrap_lib =~ m#^/usr/lib#;
       } else {
          die "Invalid installation location of libcxxwrap: library libcxxwrap_julia.$Config::Config{so} does not exist\n";
@@ -62,14 +65,14 @@ sub proceed {
    }
    if ($julia_inc) {
       if (-f "$julia_inc/julia/julia.h") {
-         $CXXFLAGS .= "-I$julia_inc -I$julia_inc/julia";
+         $CXXFLAGS .= " -I$julia_inc -I$julia_inc/julia";
       } else {
          die "Invalid installation location of julia: header file $julia_inc/julia/julia.h does not exist\n";
       }
    }
    if ($julia_lib) {
       if (-f "$julia_lib/libjulia.$Config::Config{so}") {
-         $LDFLAGS .= "-L$julia_lib";
+         $LDFLAGS .= " -L$julia_lib";
          $LDFLAGS .= " -Wl,-rpath,$julia_lib" unless $julia_lib =~ m#^/usr/lib#;
       } else {
          die "Invalid installation location of libjulia: library libjulia.$Config::Config{so} does not exist\n";
@@ -43,6 +43,41 @@ build $libname: sharedlib @obj_files
   LIBSextra=-lpolymake_julia -lcxxwrap_julia -ljulia -lpolymake
 ---
 
+# standalone benchmarks and tests of the OscarNumber runtime, not part of 'all':
+#   ninja -C build/Opt oscarnumber-bench   builds the programs in bench/
+#   ninja -C build/Opt oscarnumber-test    builds and runs the programs in test/
+# they only need an initialized julia runtime and use the reference field
+my @runtime_src = map { "$ConfigFlags{extroot}/apps/common/src/$_.cc" } qw(OscarNumber oscarnumber_dense oscarnumber_linalg oscarnumber_lp oscarnumber_reference_field);
+my @runtime_obj;
+foreach my $src_file (@runtime_src) {
+   my ($src_name, $obj_name)=basename($src_file, "cc");
+   $src_file =~ s/^\Q$root\E/\${root}/;
+   my $obj_file="\${buildtop}/bench/obj/$obj_name.o";
+   $build_cmd .= <<"---";
+build $obj_file: cxxcompile $src_file
+  CXXextraFLAGS=\${core.includes} -I\${extroot}/include/apps
+---
+   push @runtime_obj, $obj_file;
+}
+my %programs;
+foreach my $dir (qw(bench test)) {
+   foreach my $src_file (glob "$ConfigFlags{extroot}/$dir/*.cc") {
+      my ($src_name, $obj_name)=basename($src_file, "cc");
+      $src_file =~ s/^\Q$root\E/\${root}/;
+      my $obj_file="\${buildtop}/$dir/obj/$obj_name.o";
+      my $exe_file="\${buildtop}/$dir/$obj_name";
+      $build_cmd .= <<"---";
+build $obj_file: cxxcompile $src_file
+  CXXextraFLAGS=\${core.includes} -I\${extroot}/include/apps
+build $exe_file: executable $obj_file @runtime_obj
+  LIBSextra=-ljulia -lpolymake
+---
+      push @{$programs{$dir}}, $exe_file;
+   }
+}
+$build_cmd .= "build oscarnumber-bench: phony @{$programs{bench}}\n";
+$build_cmd .= "build oscarnumber-test: runprograms @{$programs{test}}\n";
+
 print "$build_cmd\n";
 
 
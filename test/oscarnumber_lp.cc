@@ -0,0 +1,162 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+// Checks of the OscarNumber LP solver on small LPs over the reference field Q(sqrt(2)),
+// with the julia callbacks (field 1) and as a native quadratic field (field 2):
+// infeasible, unbounded, redundant equations, Beale's cycling example and LPs
+// without any constraints; and the same solver as the polytope clients get it from
+// create_LP_solver<OscarNumber>.
+// Prints the failed checks and exits with status 1 if there are any.
+
+#include <julia/julia.h>
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_lp.h"
+#include "polymake/common/oscarnumber_reference_field.h"
+#include "polymake/polytope/oscarnumber_lp_solver.h"
+
+#include <cstdio>
+
+using namespace polymake;
+using namespace polymake::common;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond) \
+   do { if (!(cond)) { ++failures; std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); } } while (0)
+
+Vector<OscarNumber> vec(std::initializer_list<OscarNumber> l)
+{
+   Vector<OscarNumber> v(l.size());
+   Int i = 0;
+   for (const OscarNumber& x : l)
+      v[i++] = x;
+   return v;
+}
+
+Matrix<OscarNumber> mat(Int cols, std::initializer_list<std::initializer_list<OscarNumber>> l)
+{
+   Matrix<OscarNumber> M(l.size(), cols);
+   Int i = 0;
+   for (const auto& row : l) {
+      Int j = 0;
+      for (const OscarNumber& x : row)
+         M(i, j++) = x;
+      ++i;
+   }
+   return M;
+}
+
+void check_lp(long index)
+{
+   const OscarNumber g = reference_field_generator(index);
+   const OscarNumber zero(0), one(1);
+   const Matrix<OscarNumber> none2(0, 2), none3(0, 3);
+
+   // x >= sqrt(2) and x <= 1
+   OscarNumberLPSolution s = solve_lp(mat(2, { { -g, one }, { one, -one } }), none2, vec({ zero, one }), true);
+   CHECK(s.status == OscarNumberLPStatus::infeasible);
+
+   // x >= sqrt(2), maximize x
+   s = solve_lp(mat(2, { { -g, one } }), none2, vec({ zero, one }), true);
+   CHECK(s.status == OscarNumberLPStatus::unbounded);
+   // ... and minimize it
+   s = solve_lp(mat(2, { { -g, one } }), none2, vec({ zero, one }), false);
+   CHECK(s.status == OscarNumberLPStatus::valid && s.objective_value == g);
+
+   // x + y = sqrt(2) twice, x, y >= 0, maximize x: the second equation is redundant
+   s = solve_lp(mat(3, { { zero, one, zero }, { zero, zero, one } }),
+                mat(3, { { -g, one, one }, { -2 * g, OscarNumber(2), OscarNumber(2) } }),
+                vec({ zero, one, zero }), true);
+   CHECK(s.status == OscarNumberLPStatus::valid && s.objective_value == g);
+   CHECK(s.solution.dim() == 3 && s.solution[0] == one && s.solution[1] == g && s.solution[2] == zero);
+
+   // Beale's example, cycles with the textbook pivoting rule; x1 <= 10*sqrt(2) is redundant
+   const OscarNumber q(Rational(1, 4)), h(Rational(1, 2));
+   const Matrix<OscarNumber> beale = mat(5, {
+      { zero, -q, OscarNumber(8), one, OscarNumber(-9) },
+      { zero, -h, OscarNumber(12), h, OscarNumber(-3) },
+      { one, zero, zero, -one, zero },
+      { 10 * g, -one, zero, zero, zero },
+      { zero, one, zero, zero, zero },
+      { zero, zero, one, zero, zero },
+      { zero, zero, zero, one, zero },
+      { zero, zero, zero, zero, one } });
+   s = solve_lp(beale, Matrix<OscarNumber>(0, 5), vec({ zero, -3 * q, OscarNumber(20), -h, OscarNumber(6) }), false);
+   CHECK(s.status == OscarNumberLPStatus::valid && s.objective_value == OscarNumber(Rational(-5, 4)));
+
+   // no constraints at all: the empty basis is certified without inverting anything
+   s = solve_lp(none3, none3, vec({ g, zero, zero }), true);
+   CHECK(s.status == OscarNumberLPStatus::valid && s.objective_value == g);
+   CHECK(s.solution.dim() == 3 && s.solution[0] == one && s.solution[1] == zero && s.solution[2] == zero);
+   s = solve_lp(none3, none3, vec({ zero, g, zero }), true);
+   CHECK(s.status == OscarNumberLPStatus::unbounded);
+}
+
+// the LP_Solver interface used by H_input_feasible, rel_int_point, lineality_via_lp etc.
+void check_lp_solver(long index)
+{
+   using polytope::LP_status;
+   const auto solver_ptr = polytope::oscarnumber_interface::create_LP_solver<OscarNumber>();
+   const polytope::LP_Solver<OscarNumber>& solver = solver_ptr.get();
+   const OscarNumber g = reference_field_generator(index);
+   const OscarNumber zero(0), one(1);
+   const Matrix<OscarNumber> none2(0, 2);
+
+   // feasibility test with a zero objective: sqrt(2) <= x <= 2
+   polytope::LP_Solution<OscarNumber> s =
+      solver.solve(mat(2, { { -g, one }, { OscarNumber(2), -one } }), none2, vec({ zero, zero }), true, false);
+   CHECK(s.status == LP_status::valid && s.objective_value == zero && s.lineality_dim == -1);
+   CHECK(s.solution.dim() == 2 && s.solution[0] == one && s.solution[1] >= g && s.solution[1] <= OscarNumber(2));
+
+   // sqrt(2) <= x <= 1, the same status whether non-feasible LPs are accepted or not
+   for (bool accept_non_feasible : { false, true }) {
+      s = solver.solve(mat(2, { { -g, one }, { one, -one } }), none2, vec({ zero, one }), true, accept_non_feasible);
+      CHECK(s.status == LP_status::infeasible);
+   }
+
+   // x = sqrt(2) * y, y >= 1: unbounded in x, bounded from below
+   const Matrix<OscarNumber> ineq = mat(3, { { -one, zero, one } });
+   const Matrix<OscarNumber> eq = mat(3, { { zero, one, -g } });
+   s = solver.solve(ineq, eq, vec({ zero, one, zero }), true, false);
+   CHECK(s.status == LP_status::unbounded);
+   s = solver.solve(ineq, eq, vec({ zero, one, zero }), false, false);
+   CHECK(s.status == LP_status::valid && s.objective_value == g);
+   CHECK(s.solution.dim() == 3 && s.solution[1] == g && s.solution[2] == one);
+}
+
+}
+
+int main()
+{
+   jl_init();
+   {
+      register_reference_field(1, Rational(2));
+      register_reference_field(2, Rational(2), 0, true);
+      for (long index : { 1L, 2L }) {
+         check_lp(index);
+         check_lp_solver(index);
+      }
+   }
+   oscarnumber_prepare_cleanup();
+   jl_atexit_hook(0);
+   if (failures)
+      std::printf("%d checks failed\n", failures);
+   return failures ? 1 : 0;
+}
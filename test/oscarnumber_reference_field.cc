@@ -0,0 +1,261 @@
+/* Copyright (c) 1997-2022
+   Ewgenij Gawrilow, Michael Joswig, and the polymake team
+   Technische Universität Berlin, Germany
+   https://polymake.org
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 2, or (at your option) any
+   later version: http://www.gnu.org/licenses/gpl.txt.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+--------------------------------------------------------------------------------
+*/
+
+// Checks of the OscarNumber runtime against the reference field Q(sqrt(2)), once with
+// the julia callbacks (field 1) and once as a native quadratic field (field 2).
+// Prints the failed checks and exits with status 1 if there are any.
+
+#include <julia/julia.h>
+
+#include "polymake/common/OscarNumber.h"
+#include "polymake/common/oscarnumber_binary.h"
+#include "polymake/common/oscarnumber_dense.h"
+#include "polymake/common/oscarnumber_linalg.h"
+#include "polymake/common/oscarnumber_reference_field.h"
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace polymake;
+using namespace polymake::common;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond) \
+   do { if (!(cond)) { ++failures; std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); } } while (0)
+
+void check_field(long index)
+{
+   const OscarNumber g = reference_field_generator(index);
+   const OscarNumber one(1), two(2);
+
+   CHECK(!g.uses_rational());
+   CHECK(g.field_index() == index);
+
+   // arithmetic, rational results are demoted to rationals
+   CHECK(g * g == two);
+   CHECK((g * g).uses_rational());
+   CHECK((g + 1) * (g - 1) == one);
+   CHECK(g / g == one);
+   CHECK(g - g == OscarNumber(0));
+   CHECK(-(-g) == g);
+   // the rvalue operands are overwritten with the result
+   CHECK(g - (g + 1) == OscarNumber(-1));
+   CHECK(two / (g * g) == one);
+   CHECK((g + 1) * (one / (g + 1)) == one);
+   CHECK(2 / (g + 1) == two / (g + 1));
+   CHECK(pow(g, 4) == OscarNumber(4));
+   CHECK(pow(g, -2) == OscarNumber(Rational(1, 2)));
+
+   // comparison with rationals and field elements
+   CHECK(g > OscarNumber(Rational(141, 100)));
+   CHECK(g < OscarNumber(Rational(142, 100)));
+   CHECK(g.cmp(g + 1) < 0);
+   CHECK((g - 2).sign() < 0);
+   CHECK(abs(g - 2) == 2 - g);
+
+   // fused operations agree with the plain ones
+   OscarNumber x = g + 3;
+   x.add_mul(g, g + 1);
+   CHECK(x == g + 3 + g * (g + 1));
+   x.sub_mul(g, g + 1);
+   CHECK(x == g + 3);
+   CHECK(fma(g, g + 1, two) == g * (g + 1) + two);
+   CHECK(cross_diff(g, g + 1, g - 1, two) == g * (g + 1) - (g - 1) * two);
+   CHECK(cross_diff_div(g, g + 1, g - 1, two, g, one / g) == (g * (g + 1) - (g - 1) * two) / g);
+
+   // copies share their element until one of them is modified
+   OscarNumber y(x);
+   y += g;
+   CHECK(x == g + 3);
+   CHECK(y == 2 * g + 3);
+
+   // batched kernels
+   Vector<OscarNumber> a(3), b(3);
+   a[0] = g;  a[1] = one;    a[2] = g + 1;
+   b[0] = g;  b[1] = g - 1;  b[2] = OscarNumber(0);
+   CHECK(oscarnumber_linalg::dot(a, b) == g * g + (g - 1));
+   CHECK(oscarnumber_linalg::sign_of_dot(a, b) > 0);
+   oscarnumber_linalg::add_scaled(a, g, b);
+   CHECK(a[0] == g + g * g && a[1] == one + g * (g - 1) && a[2] == g + 1);
+
+   // a zero factor does not hide an infinite entry
+   OscarNumber ys[2] = { one, g };
+   const OscarNumber xs[2] = { g, OscarNumber::infinity(1) };
+   bool nan = false;
+   try {
+      OscarNumber::add_scaled(ys, OscarNumber(0), xs, 2);
+   }
+   catch (const pm::GMP::NaN&) {
+      nan = true;
+   }
+   CHECK(nan);
+   OscarNumber::add_scaled(ys, OscarNumber(0), xs, 1);
+   CHECK(ys[0] == one && ys[1] == g);
+
+   // elimination
+   Matrix<OscarNumber> M(2, 2);
+   M(0, 0) = g;   M(0, 1) = one;
+   M(1, 0) = one; M(1, 1) = g;
+   CHECK(oscarnumber_linalg::det(M) == one);
+   CHECK(oscarnumber_linalg::rank(M) == 2);
+   const Matrix<OscarNumber> Mi = oscarnumber_linalg::inv(M);
+   CHECK(Mi(0, 0) == g && Mi(0, 1) == -one && Mi(1, 0) == -one && Mi(1, 1) == g);
+   // fraction-free LU with a row exchange: the permuted rows are L * D^-1 * U
+   Matrix<OscarNumber> A(3, 3);
+   A(0, 0) = 0;    A(0, 1) = g;      A(0, 2) = one;
+   A(1, 0) = one;  A(1, 1) = g + 1;  A(1, 2) = two;
+   A(2, 0) = g;    A(2, 1) = one;    A(2, 2) = g - 1;
+   const oscarnumber_linalg::lu_decomposition lu = oscarnumber_linalg::fraction_free_lu(A);
+   CHECK(lu.row_perm[0] != 0);
+   bool lu_ok = true;
+   for (Int i = 0; i < 3; ++i)
+      for (Int j = 0; j < 3; ++j) {
+         OscarNumber x(0), prev(1);
+         for (Int k = 0; k < 3; ++k) {
+            x += lu.L(i, k) * lu.U(k, j) / (prev * lu.U(k, k));
+            prev = lu.U(k, k);
+         }
+         lu_ok &= x == A(lu.row_perm[i], j) && (j <= i || lu.L(i, j).is_zero()) && (j >= i || lu.U(i, j).is_zero());
+      }
+   CHECK(lu_ok);
+   CHECK(abs(lu.U(2, 2)) == abs(oscarnumber_linalg::det(A)));
+
+   // the second row becomes g times the first one
+   M(1, 0) = g * M(0, 0);  M(1, 1) = g * M(0, 1);
+   CHECK(oscarnumber_linalg::rank(M) == 1);
+   CHECK(oscarnumber_linalg::null_space(M).rows() == 1);
+
+   // serialization
+   const std::string s = (g - Rational(1, 3)).to_serialized();
+   const char* pos = s.data();
+   CHECK(OscarNumber::from_serialized(pos, s.data() + s.size(), index) == g - Rational(1, 3));
+   CHECK(pos == s.data() + s.size());
+
+   // a hand-made rational 2/4 is canonicalized, 1/0 is rejected
+   auto rational_data = [](mp_limb_t num, mp_limb_t den) {
+      std::string data(1, char(0));
+      for (mp_limb_t limb : { num, den }) {
+         const int64_t size = limb ? 1 : 0;
+         data.append(reinterpret_cast<const char*>(&size), sizeof(size));
+         data.append(reinterpret_cast<const char*>(&limb), size * sizeof(limb));
+      }
+      return data;
+   };
+   const std::string half = rational_data(2, 4);
+   pos = half.data();
+   const OscarNumber h = OscarNumber::from_serialized(pos, half.data() + half.size(), index);
+   CHECK(h == OscarNumber(Rational(1, 2)) && h.to_serialized() == rational_data(1, 2));
+   const std::string inf = rational_data(1, 0);
+   bool rejected = false;
+   try {
+      pos = inf.data();
+      OscarNumber::from_serialized(pos, inf.data() + inf.size(), index);
+   }
+   catch (const std::runtime_error&) {
+      rejected = true;
+   }
+   CHECK(rejected);
+
+   // an element of another field can't be written to a file of this one
+   const long other = index == 1 ? 2 : 1;
+   std::ostringstream os;
+   OscarNumberBinaryWriter writer(os, index, 2);
+   Vector<OscarNumber> row(2);
+   row[0] = g;
+   row[1] = reference_field_generator(other);
+   rejected = false;
+   try {
+      writer.write_row(row);
+   }
+   catch (const std::runtime_error&) {
+      rejected = true;
+   }
+   CHECK(rejected);
+}
+
+// the compact storage shares its field elements with the OscarNumbers, which copy them before modifying
+void check_dense(long index)
+{
+   const OscarNumber g = reference_field_generator(index);
+   OscarNumberDenseMatrix D(2, 3);
+   D.set(0, 0, g);
+   D.set(0, 1, OscarNumber(Rational(1, 3)));
+   D.set(1, 2, g + 1);
+   CHECK(D.field_index() == index);
+   CHECK(D(0, 0) == g && D(0, 1) == OscarNumber(Rational(1, 3)) && D(0, 2) == OscarNumber(0));
+   CHECK(D.is_rational(0, 1) && !D.is_rational(1, 2));
+
+   OscarNumber x = D(1, 2);
+   x += 1;
+   CHECK(D(1, 2) == g + 1);
+   const OscarNumberDenseMatrix C(D);
+   D.set(1, 2, OscarNumber(5));
+   D.set(0, 1, g);
+   CHECK(C(1, 2) == g + 1 && C(0, 1) == OscarNumber(Rational(1, 3)));
+   CHECK(D(1, 2) == OscarNumber(5) && D(0, 1) == g);
+
+   Int entries = 0, rational = 0;
+   const OscarNumberDenseSlice r = D.row_view(0);
+   for (auto e = r.begin(); e != r.end(); ++e, ++entries)
+      rational += e.is_rational();
+   CHECK(entries == 3 && rational == 1);
+   const Matrix<OscarNumber> M = D.to_matrix();
+   CHECK(M(0, 0) == g && M(0, 1) == g && M(1, 2) == OscarNumber(5));
+}
+
+// the parallel elimination gives the same results as the serial one
+void check_threads(long index)
+{
+   const OscarNumber g = reference_field_generator(index);
+   const Int dim = 40;
+   Matrix<OscarNumber> M(dim, dim);
+   for (Int i = 0; i < dim; ++i)
+      for (Int j = 0; j < dim; ++j)
+         M(i, j) = g * Rational((i * 7 + j * 3) % 11 - 5) + Rational((i + j * j) % 7 - 3);
+   set_oscarnumber_threads(1);
+   const OscarNumber d1 = oscarnumber_linalg::det(M);
+   const Int r1 = oscarnumber_linalg::rank(M);
+   set_oscarnumber_threads(4);
+   CHECK(oscarnumber_linalg::det(M) == d1);
+   CHECK(oscarnumber_linalg::rank(M) == r1);
+}
+
+}
+
+int main()
+{
+   jl_init();
+   {
+      register_reference_field(1, Rational(2));
+      register_reference_field(2, Rational(2), 0, true);
+      for (long index : { 1L, 2L }) {
+         check_field(index);
+         check_dense(index);
+         check_threads(index);
+      }
+   }
+   oscarnumber_prepare_cleanup();
+   jl_atexit_hook(0);
+   if (failures)
+      std::printf("%d checks failed\n", failures);
+   return failures ? 1 : 0;
+}